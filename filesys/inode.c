@@ -33,6 +33,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned write_gen;                 /* Writes so far, see inode_write_gen(). */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -124,6 +125,7 @@ inode_open (disk_sector_t sector) {
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
+	inode->write_gen = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
@@ -292,10 +294,20 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		bytes_written += chunk_size;
 	}
 	free (bounce);
+	if (bytes_written > 0)
+		inode->write_gen++;
 
 	return bytes_written;
 }
 
+/* Returns a number that changes each time INODE is written to.  A
+   copy of INODE's data read while it stayed the same is up to
+   date. */
+unsigned
+inode_write_gen (const struct inode *inode) {
+	return inode->write_gen;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
@@ -48,6 +48,14 @@ static __inline uint64_t read_eflags(void) {
 	return rflags;
 }
 
+/* Returns the time stamp counter. */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
 __attribute__((always_inline))
 static __inline uint64_t rcr3(void) {
 	uint64_t val;
@@ -123,6 +131,26 @@ static __inline uint64_t rcr2(void) {
 	__asm __volatile("movq %%cr2,%0" : "=r" (val));
 	return val;
 }
+__attribute__((always_inline))
+static __inline uint64_t rcr4(void) {
+	uint64_t val;
+	__asm __volatile("movq %%cr4,%0" : "=r" (val));
+	return val;
+}
+__attribute__((always_inline))
+static __inline void lcr4(uint64_t val) {
+	__asm __volatile("movq %0, %%cr4" : : "r" (val));
+}
+/* Executes CPUID for LEAF (sub-leaf 0) and returns the four
+ * result registers through the pointer arguments. */
+__attribute__((always_inline))
+static __inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx,
+		uint32_t *ecx, uint32_t *edx) {
+	__asm __volatile("cpuid"
+			: "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+			: "a" (leaf), "c" (0));
+}
+
 /* MSR (Model-Specific Register)
  * 디버깅, 프로그램 실행 추적, 컴퓨터 성능 모니터링 및 특정 CPU 기능 전환에 사용되는 
  * x86 명령 집합의 다양한 제어 레지스터 중 하나 */
@@ -36,6 +36,23 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MADVISE,                /* Give hints about memory use. */
+	SYS_MEMSTAT,                /* Report memory use. */
+	SYS_MEMLIMIT,               /* Limit resident memory. */
+	SYS_OOMADJ,                 /* Adjust the out-of-memory score. */
+
+	/* Debugging. */
+	SYS_STRACE,                 /* Trace the system calls of this process. */
+
+	/* Process creation without fork. */
+	SYS_SPAWN,                  /* Start a process from an executable. */
+
+	/* Shared memory. */
+	SYS_SHM_CREATE,             /* Create a shared memory segment. */
+	SYS_SHM_ATTACH,             /* Map a segment into memory. */
+	SYS_SHM_DETACH,             /* Unmap a segment. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -25,6 +25,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
+pid_t spawn (const char *file, char *const argv[]);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
@@ -37,11 +38,41 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+bool strace (bool enable);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
 
+/* Hints for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random access. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential access. */
+#define MADV_WILLNEED 3         /* Will be needed soon. */
+#define MADV_DONTNEED 4         /* Contents can be thrown away. */
+int madvise (void *addr, size_t length, int advice);
+
+/* Memory use of a process, in pages, for memstat(). */
+struct memstat {
+	size_t resident;            /* Pages mapped to a frame. */
+	size_t shared;              /* Of those, pages sharing the frame. */
+	size_t swapped;             /* Anonymous pages on swap. */
+	size_t page_table;          /* Pages holding page tables. */
+	size_t limit;               /* Cap on resident; 0 if none. */
+};
+bool memstat (struct memstat *st);
+void memlimit (size_t pages);
+
+/* Range of oomadj().  A process at OOM_ADJ_MIN is never killed. */
+#define OOM_ADJ_MIN (-1000)
+#define OOM_ADJ_MAX 1000
+void oomadj (int adj);
+
+/* Shared memory segments. */
+int shm_create (size_t size);
+void *shm_attach (int id, void *addr);
+bool shm_detach (void *addr);
+
 /* Project 4 only. */
 bool chdir (const char *dir);
 bool mkdir (const char *dir);
@@ -41,5 +41,21 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=large page (PDEs, PDPEs only). */
+#define PTE_G 0x100                      /* 1=global, kept across CR3 loads. */
+
+/* A page-directory entry with PTE_PS set maps a whole 2 MB page
+   directly instead of pointing to a page table. */
+#define HPGSHIFT PDXSHIFT
+#define HPGSIZE (1UL << HPGSHIFT)        /* Bytes in a huge page. */
+#define HPGMASK (HPGSIZE - 1)            /* Huge page offset bits. */
+#define HPGCNT (HPGSIZE / PGSIZE)        /* 4 kB pages in a huge page. */
+
+/* A page-directory-pointer entry with PTE_PS set maps 1 GB.  Only
+   the kernel's direct map uses these, and only if the CPU has them. */
+#define GPGSIZE (1UL << PDPESHIFT)       /* Bytes in a 1 GB page. */
+
+#define hpg_ofs(va) ((uint64_t) (va) & HPGMASK)
+#define hpg_round_down(va) ((void *) ((uint64_t) (va) & ~HPGMASK))
 
 #endif /* threads/pte.h */
@@ -1,16 +1,12 @@
 #ifndef THREADS_THREAD_H
 #define THREADS_THREAD_H
 
-#define FDT_PAGES 3
-#define FDCOUNT_LIMIT FDT_PAGES * (1<<9) // 3 * 512 (limit fdidx)
-										 // 페이지의 크기는 4KB(1<<12)인데, 파일 구조체 주소 크기가 8byte(1<<3)이므로, 
-										 // 이를 분리하면 512byte (1<<9)만큼의 공간을 할당받는 것과 같다.
-										 // 즉, 파일 구조체를 저장하기 위해 4KB만큼의 페이지 공간을 할당해주는 것이다.
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "userprog/fdtable.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -99,6 +95,8 @@ struct thread {
 	int priority;                       /* Priority. */
 	int64_t wakeup_tick; 				/* 깨어나야 할 tick */
 
+	struct list_elem allelem;           /* List element for all threads list. */
+
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 
@@ -121,6 +119,16 @@ struct thread {
 	struct supplemental_page_table spt;
 	void *stack_bottom;
 	void *rsp_stack;
+
+	/* Memory accounting, see vm_memstat(). */
+	size_t rss_pages;                   /* Pages mapped to a frame. */
+	size_t swap_pages;                  /* Anonymous pages on swap. */
+	size_t rss_limit;                   /* Cap on rss_pages; 0 if none. */
+
+	/* Out-of-memory killing, see oom_kill(). */
+	int oom_adj;                        /* Added to the badness score. */
+	bool oom_killed;                    /* Chosen to be killed. */
+	int64_t start_tick;                 /* When the process started. */
 #endif
 
 	/* Owned by thread.c. */
@@ -128,8 +136,7 @@ struct thread {
 	unsigned magic;                     /* Detects stack overflow. */
 
 	/* --- Project2: User programs - system call --- */
-	struct file **file_descriptor_table; // FDF
-	int fdidx; // fd idx
+	struct fdtable fdt; // FDT, 필요할 때마다 늘어난다 (userprog/fdtable.c)
 
 	struct list child_list;			// _fork(), wait() 구현 때 사용
 	struct list_elem child_elem; 	// _fork(), wait() 구현 때 사용
@@ -137,12 +144,13 @@ struct thread {
 	int exit_status; // exit(), wait() 구현 때 사용
 
 
-	struct intr_frame parent_if;	// _fork() 구현 때 사용, __do_fork() 함수
+	struct intr_frame *parent_if;	// _fork() 구현 때 사용, __do_fork() 함수. fork 중인 부모의 시스템콜 프레임
 	struct semaphore fork_sema;
 	struct semaphore free_sema;
 	struct semaphore wait_sema;
 
 	struct file *running;
+	struct strace *strace;	// 시스템콜 기록 (userprog/strace.c), 안 켰으면 NULL
 
 	int stdin_count;
 	int stdout_count;
@@ -169,6 +177,10 @@ tid_t thread_tid (void);
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
+
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func (struct thread *t, void *aux);
+void thread_foreach (thread_action_func *, void *);
 void thread_yield (void);
 
 int thread_get_priority (void);
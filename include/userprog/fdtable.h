@@ -0,0 +1,36 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Most file descriptors a process can have open. */
+#define FDCOUNT_LIMIT 1536
+/* Slots a new table starts with.  It grows on demand. */
+#define FDT_INIT_SIZE 16
+#define FDT_WORDS (FDCOUNT_LIMIT / 64)
+
+/* File descriptor table of a process.
+
+   FILES[fd] is the open file of fd, or NULL.  Every slot in use
+   has its bit set in USED, and FULL has a bit set for each word of
+   USED that has no free slot left, so the lowest free fd is found
+   with two bit scans. */
+struct fdtable {
+	struct file **files;        /* Slots, grown with realloc(). */
+	int size;                   /* Number of slots in FILES. */
+	uint64_t used[FDT_WORDS];   /* Bit per slot: in use. */
+	uint32_t full;              /* Bit per word of USED: all in use. */
+};
+
+bool fdt_init (struct fdtable *);
+void fdt_destroy (struct fdtable *);
+bool fdt_grow (struct fdtable *, int fd);
+int fdt_alloc (struct fdtable *, struct file *);
+void fdt_set (struct fdtable *, int fd, struct file *);
+struct file *fdt_get (const struct fdtable *, int fd);
+void fdt_clear (struct fdtable *, int fd);
+int fdt_next (const struct fdtable *, int fd);
+bool fdt_full (const struct fdtable *);
+
+#endif /* userprog/fdtable.h */
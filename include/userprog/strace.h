@@ -0,0 +1,19 @@
+#ifndef USERPROG_STRACE_H
+#define USERPROG_STRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* -strace=PROG: trace every process that executes PROG. */
+extern const char *strace_prog;
+
+bool strace_start (struct thread *);
+void strace_stop (struct thread *);
+void strace_exec (const char *prog);
+size_t strace_enter (struct thread *, uint64_t nr,
+                     const uint64_t *arg, int argc);
+void strace_leave (struct thread *, size_t seq, uint64_t ret);
+
+#endif /* userprog/strace.h */
@@ -16,6 +16,9 @@
 #include "threads/synch.h"
 
 void syscall_init (void);
+void syscall_print_stats (void);
+
+extern bool syscall_stats;
 
 struct lock filesys_lock;
 
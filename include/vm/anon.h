@@ -11,5 +11,9 @@ struct anon_page {
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void swap_slot_dup (struct page *page);
+int swap_store (const void *kva);
+void swap_load (int slot, void *kva);
+void swap_discard (int slot);
 
 #endif
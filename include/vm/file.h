@@ -7,6 +7,9 @@ struct page;
 enum vm_type;
 
 struct file_page {
+	struct inode *inode;    /* Backing file, reopened for this page. */
+	off_t offset;           /* Offset of the page in the file. */
+	size_t read_bytes;      /* Bytes from the file; the rest is zero. */
 };
 
 void vm_file_init (void);
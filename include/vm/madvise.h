@@ -0,0 +1,23 @@
+#ifndef VM_MADVISE_H
+#define VM_MADVISE_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Access hints for madvise().  The values match lib/user/syscall.h. */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Random access: no fault-around. */
+#define MADV_SEQUENTIAL 2       /* Read far ahead, reclaim behind. */
+#define MADV_WILLNEED 3         /* Load the range in the background. */
+#define MADV_DONTNEED 4         /* Drop the range's contents now. */
+
+struct supplemental_page_table;
+
+void madvise_init (void);
+int do_madvise (void *addr, size_t length, int advice);
+int madvise_get (struct supplemental_page_table *spt, void *va);
+bool madvise_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src);
+void madvise_cancel (struct supplemental_page_table *spt);
+void madvise_destroy (struct supplemental_page_table *spt);
+
+#endif
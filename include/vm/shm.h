@@ -0,0 +1,52 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+struct page;
+struct thread;
+enum vm_type;
+
+/* Where page N of a segment is: in FRAME, on swap at SLOT, or
+ * nowhere yet (all zeros) if FRAME is null and SLOT is -1.
+ * Protected by frame_lock, except that the eviction of FRAME sets
+ * SLOT while FRAME is marked FRAME_EVICT. */
+struct shm_entry {
+	struct frame *frame;
+	int slot;
+};
+
+/* A shared memory segment.  Every process that attaches it maps
+ * the same frames, so a write by one is seen by all at once. */
+struct shm {
+	int id;                     /* Returned by shm_create(). */
+	size_t page_cnt;            /* Size in pages. */
+	int attach_cnt;             /* Areas mapping the segment. */
+	struct thread *creator;     /* Creating process, until it exits. */
+	struct lock lock;           /* Held while a page is brought in. */
+	struct list_elem elem;      /* Element in the segment list. */
+	struct shm_entry pages[];   /* One per page. */
+};
+
+/* A page of a segment. */
+struct shm_page {
+	struct shm *shm;            /* Segment. */
+	size_t idx;                 /* Page number in the segment. */
+};
+
+/* Largest segment, in pages. */
+#define SHM_MAX_PAGES 1024
+
+void shm_init (void);
+bool shm_initializer (struct page *page, enum vm_type type, void *kva);
+void shm_get (struct shm *shm);
+void shm_put (struct shm *shm);
+void shm_exit (struct thread *t);
+
+int do_shm_create (size_t size);
+void *do_shm_attach (int id, void *addr);
+bool do_shm_detach (void *addr);
+
+#endif
@@ -2,6 +2,7 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "include/lib/kernel/hash.h"
 
 enum vm_type {
@@ -13,6 +14,8 @@ enum vm_type {
 	VM_FILE = 2,
 	/* page that hold the page cache, for project 4 */
 	VM_PAGE_CACHE = 3,
+	/* page of a shared memory segment, see shm.c */
+	VM_SHM = 4,
 
 	/* Bit flags to store state */
 
@@ -25,9 +28,16 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Marks an anonymous page whose initial contents are all zeros,
+ * e.g. the BSS tail of a segment.  Such a page needs no
+ * initializer and may be backed by part of a 2 MB page. */
+#define VM_ZERO VM_MARKER_1
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
+#include "vm/shm.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -47,6 +57,10 @@ struct page {
 	bool writable;
 	/* Your implementation */
 	struct hash_elem hash_elem; /* Hash table element */
+	struct thread *owner;       /* Process whose pml4 maps this page. */
+	struct page *frame_next;    /* Next page sharing FRAME. */
+	struct vma *vma;            /* Area the page belongs to, or NULL. */
+	struct list_elem vma_elem;  /* Element in vma->pages. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -54,19 +68,40 @@ struct page {
 		struct uninit_page uninit; 	// 기본 값; uninit_page
 		struct anon_page anon;		// annoymous memory
 		struct file_page file;		// filed-backed memory
+		struct shm_page shm;		// shared memory segment
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".
+ * There is exactly one frame per page of the user pool, kept in
+ * the frame table, an array indexed by physical frame number that
+ * vm_init() sizes from the user pool.  Frames are never allocated
+ * or freed; a frame is in use while PAGE is non-null, or while a
+ * shared memory segment keeps it for its next mapping (see shm.c).
+ *
+ * After fork, several pages may share one frame copy-on-write.
+ * They form a list through page->frame_next that starts at PAGE,
+ * and all of them are mapped read-only. */
 struct frame {
 	void *kva;	// 커널 가상 주소
-	struct page *page;
-	struct list frame_elem;
+	struct page *page;          /* First page using this frame, or NULL. */
+	uint16_t pin_cnt;           /* If nonzero, frame must not be evicted. */
+	uint16_t map_cnt;           /* Number of pages using this frame. */
+	uint8_t ref;                /* Reference bits for eviction. */
+	uint8_t flags;              /* FRAME_* flags. */
 };
 
+/* Frame flags. */
+#define FRAME_HUGE 0x1          /* Part of a 2 MB page mapping. */
+#define FRAME_TEXT 0x2          /* In the text cache. */
+#define FRAME_KSM 0x4           /* Merged by the same-page scanner. */
+#define FRAME_RECLAIM 0x8       /* Left behind by sequential access. */
+#define FRAME_ZERO 0x10         /* The shared zero frame. */
+#define FRAME_EVICT 0x20        /* Being written out, see vm_evict_frames(). */
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -88,7 +123,24 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
-	struct hash *pages;
+	struct hash *pages;         /* Pages touched so far, by address. */
+	struct vma *vmas;           /* Root of the area tree, see vma.c. */
+	struct thread *owner;       /* Process owning the table. */
+	struct list hints;          /* madvise() hints, see madvise.c. */
+	struct lock lock;           /* Held while pages are added, loaded
+	                               or dropped. */
+	void *swap_va;              /* Page swapped out last, and its slot, */
+	int swap_slot;              /* see swap_slot_alloc(). */
+};
+
+/* Memory use of a process, in pages, as reported by memstat().
+ * The user-side copy is in lib/user/syscall.h. */
+struct memstat {
+	size_t resident;            /* Pages mapped to a frame. */
+	size_t shared;              /* Of those, pages sharing the frame. */
+	size_t swapped;             /* Anonymous pages on swap. */
+	size_t page_table;          /* Pages holding page tables. */
+	size_t limit;               /* Cap on resident; 0 if none. */
 };
 
 #include "threads/thread.h"
@@ -98,10 +150,24 @@ bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
+struct page *spt_get_page (struct supplemental_page_table *spt, void *va);
+bool spt_alloc_page (struct supplemental_page_table *spt, enum vm_type type,
+		void *upage, bool writable, vm_initializer *init, void *aux);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+extern unsigned vm_fault_around;
+extern unsigned vm_ksm_rate;
+extern unsigned vm_wmark_low;
+extern unsigned vm_wmark_high;
+
+/* Range of oom_adj.  A process at OOM_ADJ_MIN is never killed. */
+#define OOM_ADJ_MIN (-1000)
+#define OOM_ADJ_MAX 1000
+
 void vm_init (void);
+void vm_print_stats (void);
+void vm_memstat (struct memstat *st);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -110,7 +176,13 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+struct frame *vm_frame_of (void *kva);
+void vm_free_frame (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_prefault_page (struct page *page);
+void vm_discard_page (struct page *page);
+bool vm_pin_page (struct page *page);
+void vm_unpin_page (struct page *page);
 enum vm_type page_get_type (struct page *page);
 void page_destructor(struct hash_elem* hash_elem, void* aux);
 
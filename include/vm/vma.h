@@ -0,0 +1,47 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct supplemental_page_table;
+struct shm;
+
+/* A virtual memory area: a run of pages with the same origin.
+ * Pages are created from it one by one as they are first touched
+ * (see spt_get_page).  Bytes [0, READ_BYTES) of the area come from
+ * FILE at OFFSET through INIT; the rest are zeros. */
+struct vma {
+	struct vma *left, *right;   /* Children in the area tree. */
+	int height;                 /* Height of the subtree rooted here. */
+
+	uint8_t *start, *end;       /* Page-aligned range [START, END). */
+	enum vm_type type;          /* Type of pages holding file data. */
+	bool writable;
+	int flags;                  /* VMA_* flags. */
+	vm_initializer *init;       /* Loads file data into a page. */
+	struct file *file;          /* Backing file, or NULL. */
+	off_t offset;               /* File offset of START. */
+	size_t read_bytes;          /* Bytes that come from FILE. */
+	struct shm *shm;            /* Segment mapped here, or NULL. */
+	struct list pages;          /* Pages created so far. */
+};
+
+/* Area flags. */
+#define VMA_MMAP 0x1            /* Made by mmap(); owns FILE. */
+
+struct vma *vma_map (struct supplemental_page_table *spt, void *start,
+		size_t length, bool writable, enum vm_type type);
+void vma_unmap (struct supplemental_page_table *spt, struct vma *vma);
+struct vma *vma_find (struct supplemental_page_table *spt, const void *va);
+bool vma_overlaps (struct supplemental_page_table *spt,
+		const void *start, const void *end);
+bool vma_alloc_page (struct supplemental_page_table *spt, struct vma *vma,
+		void *va);
+bool vma_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src);
+void vma_destroy (struct supplemental_page_table *spt);
+
+#endif
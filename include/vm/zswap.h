@@ -0,0 +1,17 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Writes the uncompressed PAGE to swap slot SLOT on disk. */
+typedef void zswap_writeback_func (int slot, const void *page);
+
+extern unsigned zswap_percent;
+
+void zswap_init (size_t max_bytes, zswap_writeback_func *writeback);
+bool zswap_store (int slot, const void *page);
+bool zswap_load (int slot, void *page);
+void zswap_invalidate (int slot);
+void zswap_print_stats (void);
+
+#endif
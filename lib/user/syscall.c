@@ -145,6 +145,16 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+pid_t
+spawn (const char *file, char *const argv[]) {
+	return (pid_t) syscall2 (SYS_SPAWN, file, argv);
+}
+
+bool
+strace (bool enable) {
+	return syscall1 (SYS_STRACE, enable);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
@@ -155,6 +165,41 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+bool
+memstat (struct memstat *st) {
+	return syscall1 (SYS_MEMSTAT, st);
+}
+
+void
+memlimit (size_t pages) {
+	syscall1 (SYS_MEMLIMIT, pages);
+}
+
+void
+oomadj (int adj) {
+	syscall1 (SYS_OOMADJ, adj);
+}
+
+int
+shm_create (size_t size) {
+	return syscall1 (SYS_SHM_CREATE, size);
+}
+
+void *
+shm_attach (int id, void *addr) {
+	return (void *) syscall2 (SYS_SHM_ATTACH, id, addr);
+}
+
+bool
+shm_detach (void *addr) {
+	return syscall1 (SYS_SHM_DETACH, addr);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,49 @@
+/* Opens the same file many more times than the 16 slots a file
+   descriptor table starts with.  Every open must succeed with a
+   distinct descriptor, the lowest free descriptor must be reused,
+   and a forked child must inherit the whole table. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FD_CNT 100
+
+void
+test_main (void) 
+{
+  int fds[FD_CNT];
+  char c;
+  int pid;
+  int i, j;
+
+  for (i = 0; i < FD_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d returned %d", i, fds[i]);
+      for (j = 0; j < i; j++)
+        if (fds[j] == fds[i])
+          fail ("open #%d and #%d both returned %d", j, i, fds[i]);
+    }
+  msg ("open \"sample.txt\" %d times", FD_CNT);
+
+  close (fds[FD_CNT / 2]);
+  CHECK (open ("sample.txt") == fds[FD_CNT / 2],
+         "reopen gets the descriptor just closed");
+
+  if ((pid = fork ("child")))
+    {
+      msg ("Parent: child exit status is %d", wait (pid));
+      seek (fds[FD_CNT - 1], 0);
+      CHECK (read (fds[FD_CNT - 1], &c, 1) == 1 && c == sample[0],
+             "read the last descriptor");
+    }
+  else
+    {
+      CHECK (read (fds[FD_CNT - 1], &c, 1) == 1 && c == sample[0],
+             "child reads the last descriptor");
+      exit (81);
+    }
+}
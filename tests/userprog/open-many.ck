@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) open "sample.txt" 100 times
+(open-many) reopen gets the descriptor just closed
+(open-many) child reads the last descriptor
+child: exit(81)
+(open-many) Parent: child exit status is 81
+(open-many) read the last descriptor
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,16 @@
+/* Spawns a child process with arguments and waits for it.  The
+   child must see the arguments like an exec()ed process does. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *argv[] = { "child-args", "childarg", NULL };
+  pid_t pid;
+
+  CHECK ((pid = spawn ("child-args", argv)) > 0, "spawn \"child-args\"");
+  msg ("child exit status is %d", wait (pid));
+}
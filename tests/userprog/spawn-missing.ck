@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-missing) begin
+load: no-such-file: open failed
+no-such-file: exit(-1)
+(spawn-missing) spawn("no-such-file"): -1
+(spawn-missing) end
+spawn-missing: exit(0)
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Measures the round trip time of a few system calls, in cycles
+   of the time stamp counter.  Not a test: the numbers depend on
+   the machine.  Run with
+   `pintos -p tests/userprog/syscall-bench:syscall-bench -p ../../tests/userprog/sample.txt:sample.txt -- -q -f run syscall-bench',
+   and add -sysstat to see the kernel's side of the same calls. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERS 10000
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Runs CALL ITERS times and reports the cycles per call. */
+#define BENCH(NAME, CALL)                                       \
+  do {                                                          \
+    uint64_t start = rdtsc ();                                  \
+    int i;                                                      \
+    for (i = 0; i < ITERS; i++)                                 \
+      CALL;                                                     \
+    msg ("%s: %llu cycles/call", NAME,                          \
+         (unsigned long long) (rdtsc () - start) / ITERS);      \
+  } while (0)
+
+void
+test_main (void) 
+{
+  char buf[1];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  BENCH ("close(-1)", close (-1));
+  BENCH ("filesize", filesize (handle));
+  BENCH ("tell", tell (handle));
+  BENCH ("read 1 byte", (seek (handle, 0), read (handle, buf, 1)));
+  BENCH ("write 0 bytes", write (handle, buf, 0));
+}
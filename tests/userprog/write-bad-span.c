@@ -0,0 +1,20 @@
+/* Passes the write system call a buffer that starts in valid
+   memory but runs on into unmapped memory.  The kernel notices
+   only when it touches the bad part, and must still terminate
+   the process with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  int handle;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  write (handle, buf, 64 * 1024 * 1024);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(write-bad-span) begin
+(write-bad-span) open "sample.txt"
+write-bad-span: exit(-1)
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Checks that writes after fork stay private to the process that
+   makes them: the child sees the parent's data, and neither sees
+   what the other writes afterwards, even while both run. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BUF_SIZE (64 * 1024)
+
+static char buf[BUF_SIZE];
+
+/* Returns true if the SIZE bytes at P are all C. */
+static bool
+all_equal (const char *p, char c, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  memset (buf, 'p', BUF_SIZE);
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (all_equal (buf, 'p', BUF_SIZE), "child sees the parent's data");
+      memset (buf, 'c', BUF_SIZE);
+      CHECK (all_equal (buf, 'c', BUF_SIZE), "child sees its own writes");
+      exit (81);
+    }
+
+  /* Races with the child on purpose. */
+  memset (buf, 'q', BUF_SIZE / 2);
+  CHECK (wait (child) == 81, "wait for child");
+  CHECK (all_equal (buf, 'q', BUF_SIZE / 2)
+         && all_equal (buf + BUF_SIZE / 2, 'p', BUF_SIZE / 2),
+         "parent's data is unaffected by the child");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-write) begin
+(cow-write) child sees the parent's data
+(cow-write) child sees its own writes
+(cow-write) wait for child
+(cow-write) parent's data is unaffected by the child
+(cow-write) end
+EOF
+pass;
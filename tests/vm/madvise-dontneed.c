@@ -0,0 +1,51 @@
+/* Throws away pages with madvise(MADV_DONTNEED).  Anonymous memory
+   must come back zero-filled, and a modified file page must be
+   written back first and read back from the file. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define ACTUAL ((char *) 0x10000000)
+
+static char anon[3 * PAGE];
+
+void
+test_main (void)
+{
+  static const char overwrite[] = "Now is the time for all good...";
+  static char buf[sizeof sample - 1];
+  char *p = (char *) (((uintptr_t) anon + PAGE - 1) & ~(uintptr_t) (PAGE - 1));
+  int handle;
+  size_t i;
+
+  memset (p, 'a', 2 * PAGE);
+  CHECK (madvise (p, 2 * PAGE, MADV_DONTNEED) == 0,
+         "madvise anonymous pages DONTNEED");
+  for (i = 0; i < 2 * PAGE; i++)
+    if (p[i] != 0)
+      fail ("byte %zu is %d after DONTNEED, not zero", i, p[i]);
+  msg ("anonymous pages read back as zeros");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (ACTUAL, PAGE, 1, handle, 0) == ACTUAL, "mmap \"sample.txt\"");
+  memcpy (ACTUAL, overwrite, strlen (overwrite));
+  CHECK (madvise (ACTUAL, PAGE, MADV_DONTNEED) == 0,
+         "madvise mapped page DONTNEED");
+  if (memcmp (ACTUAL, overwrite, strlen (overwrite))
+      || memcmp (ACTUAL + strlen (overwrite), sample + strlen (overwrite),
+                 strlen (sample) - strlen (overwrite)))
+    fail ("mapped page lost its changes");
+  msg ("mapped page kept its changes");
+
+  CHECK (read (handle, buf, sizeof buf) == sizeof buf, "read \"sample.txt\"");
+  if (memcmp (buf, overwrite, strlen (overwrite)))
+    fail ("DONTNEED did not write back the modified page");
+  msg ("file holds the changes");
+  munmap (ACTUAL);
+  close (handle);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) madvise anonymous pages DONTNEED
+(madvise-dontneed) anonymous pages read back as zeros
+(madvise-dontneed) open "sample.txt"
+(madvise-dontneed) mmap "sample.txt"
+(madvise-dontneed) madvise mapped page DONTNEED
+(madvise-dontneed) mapped page kept its changes
+(madvise-dontneed) read "sample.txt"
+(madvise-dontneed) file holds the changes
+(madvise-dontneed) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Prefaults part of a mapped file with madvise(MADV_WILLNEED) and
+   sets the other hints, checking that none of them changes what
+   the process sees, and that bad arguments are refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE 4096
+#define PAGE_CNT 64
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (ACTUAL, PAGE_CNT * PAGE, 0, handle, 0) == ACTUAL,
+         "mmap \"large.txt\"");
+  CHECK (madvise (ACTUAL, PAGE_CNT * PAGE / 2, MADV_WILLNEED) == 0,
+         "madvise first half WILLNEED");
+  CHECK (madvise (ACTUAL + PAGE_CNT * PAGE / 2, PAGE_CNT * PAGE / 4,
+                  MADV_SEQUENTIAL) == 0,
+         "madvise third quarter SEQUENTIAL");
+  CHECK (madvise (ACTUAL + PAGE_CNT * PAGE / 4 * 3, PAGE_CNT * PAGE / 4,
+                  MADV_RANDOM) == 0,
+         "madvise last quarter RANDOM");
+  if (memcmp (ACTUAL, large, PAGE_CNT * PAGE))
+    fail ("read of mmap'd file reported bad data");
+  msg ("mapped data is intact");
+
+  CHECK (madvise (ACTUAL + 1, PAGE, MADV_WILLNEED) == -1,
+         "madvise misaligned address");
+  CHECK (madvise (ACTUAL, PAGE, 42) == -1, "madvise unknown advice");
+  CHECK (madvise ((void *) 0x8004000000, PAGE, MADV_WILLNEED) == -1,
+         "madvise kernel address");
+  munmap (ACTUAL);
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-willneed) begin
+(madvise-willneed) open "large.txt"
+(madvise-willneed) mmap "large.txt"
+(madvise-willneed) madvise first half WILLNEED
+(madvise-willneed) madvise third quarter SEQUENTIAL
+(madvise-willneed) madvise last quarter RANDOM
+(madvise-willneed) mapped data is intact
+(madvise-willneed) madvise misaligned address
+(madvise-willneed) madvise unknown advice
+(madvise-willneed) madvise kernel address
+(madvise-willneed) end
+EOF
+pass;
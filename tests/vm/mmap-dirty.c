@@ -0,0 +1,54 @@
+/* Maps four pages of a file and reads all of them, but writes to
+   only one.  Meanwhile another page is changed through write().
+   munmap must write back the modified page and leave the clean
+   ones alone, so that both changes end up in the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define ACTUAL ((char *) 0x10000000)
+#define PAGE 4096
+
+static char buf[PAGE];
+static char mapped[PAGE];
+static char written[PAGE];
+
+void
+test_main (void)
+{
+  int handle;
+  int i;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (ACTUAL, 4 * PAGE, 1, handle, 0) == ACTUAL,
+         "mmap \"large.txt\"");
+  if (memcmp (ACTUAL, large, 4 * PAGE))
+    fail ("read of mmap'd file reported bad data");
+
+  msg ("write to page 1 through the mapping");
+  memset (mapped, 'm', PAGE);
+  memcpy (ACTUAL + PAGE, mapped, PAGE);
+
+  memset (written, 'w', PAGE);
+  seek (handle, 3 * PAGE);
+  CHECK (write (handle, written, PAGE) == PAGE, "write page 3 with write()");
+
+  msg ("munmap \"large.txt\"");
+  munmap (ACTUAL);
+
+  seek (handle, 0);
+  for (i = 0; i < 4; i++)
+    {
+      const char *expected = i == 1 ? mapped
+                             : i == 3 ? written : large + i * PAGE;
+
+      CHECK (read (handle, buf, PAGE) == PAGE, "read page %d", i);
+      if (memcmp (buf, expected, PAGE))
+        fail ("page %d has the wrong data", i);
+    }
+  msg ("only the modified page was written back");
+  close (handle);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-dirty) begin
+(mmap-dirty) open "large.txt"
+(mmap-dirty) mmap "large.txt"
+(mmap-dirty) write to page 1 through the mapping
+(mmap-dirty) write page 3 with write()
+(mmap-dirty) munmap "large.txt"
+(mmap-dirty) read page 0
+(mmap-dirty) read page 1
+(mmap-dirty) read page 2
+(mmap-dirty) read page 3
+(mmap-dirty) only the modified page was written back
+(mmap-dirty) end
+EOF
+pass;
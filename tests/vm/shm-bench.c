@@ -0,0 +1,155 @@
+/* Passes 1 MB from a producer to a consumer process, once through
+   a shared memory segment used as a ring buffer and once through a
+   file, and reports the cycles each took.  Not a test: the numbers
+   depend on the machine.  Run with
+   `pintos -p tests/vm/shm-bench:shm-bench --swap-disk=4 -- -q -f run shm-bench'. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHUNK 4096
+#define TOTAL (1024 * 1024)
+#define RING_CHUNKS 16
+
+/* The segment: counters in the first page, the ring after it. */
+struct ring
+  {
+    volatile size_t head;           /* Bytes produced. */
+    volatile size_t tail;           /* Bytes consumed. */
+    char pad[CHUNK - 2 * sizeof (size_t)];
+    char data[RING_CHUNKS * CHUNK];
+  };
+
+#define RING ((struct ring *) 0x10000000)
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+#define barrier() asm volatile ("" : : : "memory")
+
+/* Byte I of the message. */
+static inline char
+pattern (size_t i)
+{
+  return (char) (i * 7 + i / CHUNK);
+}
+
+/* Returns the number of bytes of BUF, which holds bytes [OFS,
+   OFS + CHUNK) of the message, that are wrong. */
+static int
+check_chunk (const char *buf, size_t ofs)
+{
+  int bad = 0;
+  size_t i;
+
+  for (i = 0; i < CHUNK; i++)
+    if (buf[i] != pattern (ofs + i))
+      bad++;
+  return bad;
+}
+
+static void
+fill_chunk (char *buf, size_t ofs)
+{
+  size_t i;
+
+  for (i = 0; i < CHUNK; i++)
+    buf[i] = pattern (ofs + i);
+}
+
+static void
+bench_shm (void)
+{
+  uint64_t start;
+  pid_t pid;
+  size_t ofs;
+  int id;
+
+  CHECK ((id = shm_create (sizeof (struct ring))) >= 0, "shm_create");
+  CHECK (shm_attach (id, RING) == RING, "shm_attach");
+  start = rdtsc ();
+  pid = fork ("consumer");
+  if (pid == 0)
+    {
+      int bad = 0;
+
+      for (ofs = 0; ofs < TOTAL; ofs += CHUNK)
+        {
+          while (RING->head == ofs)
+            continue;
+          barrier ();
+          bad += check_chunk (RING->data + ofs % sizeof RING->data, ofs);
+          barrier ();
+          RING->tail = ofs + CHUNK;
+        }
+      exit (bad);
+    }
+  CHECK (pid > 0, "fork");
+  for (ofs = 0; ofs < TOTAL; ofs += CHUNK)
+    {
+      while (ofs - RING->tail == sizeof RING->data)
+        continue;
+      barrier ();
+      fill_chunk (RING->data + ofs % sizeof RING->data, ofs);
+      barrier ();
+      RING->head = ofs + CHUNK;
+    }
+  CHECK (wait (pid) == 0, "consumer saw the right data");
+  msg ("shm: %llu cycles for %d kB",
+       (unsigned long long) (rdtsc () - start), TOTAL / 1024);
+  CHECK (shm_detach (RING), "shm_detach");
+}
+
+static void
+bench_file (void)
+{
+  static char buf[CHUNK];
+  uint64_t start;
+  pid_t pid;
+  size_t ofs;
+  int fd;
+
+  CHECK (create ("shm-bench.dat", 0), "create \"shm-bench.dat\"");
+  start = rdtsc ();
+  CHECK ((fd = open ("shm-bench.dat")) > 1, "open \"shm-bench.dat\"");
+  for (ofs = 0; ofs < TOTAL; ofs += CHUNK)
+    {
+      fill_chunk (buf, ofs);
+      if (write (fd, buf, CHUNK) != CHUNK)
+        fail ("write failed at %zu", ofs);
+    }
+  close (fd);
+  pid = fork ("consumer");
+  if (pid == 0)
+    {
+      int bad = 0;
+
+      fd = open ("shm-bench.dat");
+      for (ofs = 0; ofs < TOTAL; ofs += CHUNK)
+        {
+          if (read (fd, buf, CHUNK) != CHUNK)
+            exit (-1);
+          bad += check_chunk (buf, ofs);
+        }
+      exit (bad);
+    }
+  CHECK (pid > 0, "fork");
+  CHECK (wait (pid) == 0, "consumer saw the right data");
+  msg ("file: %llu cycles for %d kB",
+       (unsigned long long) (rdtsc () - start), TOTAL / 1024);
+  remove ("shm-bench.dat");
+}
+
+void
+test_main (void)
+{
+  bench_shm ();
+  bench_file ();
+}
@@ -0,0 +1,59 @@
+/* Creates a shared memory segment, attaches it, and shares it with
+   a forked child: each process must see what the other writes.
+   Also checks that a detached segment is no longer accessible,
+   that it keeps its data until attached again, and that bad
+   attaches and detaches are refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define SEG ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  pid_t child;
+  int id;
+  int i;
+
+  CHECK ((id = shm_create (2 * PAGE)) >= 0, "shm_create");
+  CHECK (shm_attach (id, SEG) == SEG, "shm_attach");
+  for (i = 0; i < 2 * PAGE; i++)
+    if (SEG[i] != 0)
+      fail ("byte %d of a new segment is %d, not zero", i, SEG[i]);
+  msg ("segment starts out zero-filled");
+  CHECK (shm_attach (id, SEG + PAGE) == NULL,
+         "shm_attach over the segment fails");
+  strlcpy (SEG, "parent", PAGE);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (!strcmp (SEG, "parent"), "child sees the parent's data");
+      strlcpy (SEG + PAGE, "child", PAGE);
+      exit (81);
+    }
+  CHECK (wait (child) == 81, "wait for child");
+  CHECK (!strcmp (SEG + PAGE, "child"), "parent sees the child's data");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (shm_detach (SEG), "child detaches the segment");
+      msg ("child touches the detached segment");
+      SEG[0] = 'x';
+      fail ("should have exited with -1");
+    }
+  CHECK (wait (child) == -1, "wait for child");
+
+  CHECK (shm_detach (SEG), "shm_detach");
+  CHECK (!shm_detach (SEG), "shm_detach again fails");
+  CHECK (shm_attach (id, SEG) == SEG, "shm_attach again");
+  CHECK (!strcmp (SEG, "parent") && !strcmp (SEG + PAGE, "child"),
+         "segment kept its data");
+  CHECK (shm_detach (SEG), "shm_detach");
+  CHECK (shm_attach (id + 1000, SEG) == NULL, "shm_attach unknown id fails");
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-share) begin
+(shm-share) shm_create
+(shm-share) shm_attach
+(shm-share) segment starts out zero-filled
+(shm-share) shm_attach over the segment fails
+(shm-share) child sees the parent's data
+(shm-share) wait for child
+(shm-share) parent sees the child's data
+(shm-share) child detaches the segment
+(shm-share) child touches the detached segment
+(shm-share) wait for child
+(shm-share) shm_detach
+(shm-share) shm_detach again fails
+(shm-share) shm_attach again
+(shm-share) segment kept its data
+(shm-share) shm_detach
+(shm-share) shm_attach unknown id fails
+(shm-share) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Measures how long a process takes to get its memory back from
+   swap once memory pressure is gone, with and without swap
+   readahead.  The working set is pushed out to swap by touching a
+   larger buffer, then read back in address order; the second time
+   the working set is marked MADV_RANDOM, which turns readahead
+   off.  Not a test: the numbers depend on the machine.  Run with
+   `pintos -m 10 --swap-disk=30 -p tests/vm/swap-bench:swap-bench -- -q -f run swap-bench'. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define WORK_SIZE (4 * ONE_MB)
+#define PRESSURE_SIZE (12 * ONE_MB)
+
+static char work[WORK_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static char pressure[PRESSURE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Writes one byte of each page of BUF. */
+static void
+touch (char *buf, size_t size, char seed)
+{
+  size_t i;
+
+  for (i = 0; i < size; i += PAGE_SIZE)
+    buf[i] = (char) (i / PAGE_SIZE) + seed;
+}
+
+/* Reads the working set back in and reports the cycles it took. */
+static void
+recover (const char *name)
+{
+  uint64_t start;
+  size_t i;
+
+  touch (pressure, PRESSURE_SIZE, 1);
+  start = rdtsc ();
+  for (i = 0; i < WORK_SIZE; i += PAGE_SIZE)
+    if (work[i] != (char) (i / PAGE_SIZE))
+      fail ("page %zu of the working set is wrong", i / PAGE_SIZE);
+  msg ("%s: %llu cycles to read back %d pages", name,
+       (unsigned long long) (rdtsc () - start), WORK_SIZE / PAGE_SIZE);
+}
+
+void
+test_main (void)
+{
+  touch (work, WORK_SIZE, 0);
+  recover ("readahead");
+  CHECK (madvise (work, WORK_SIZE, MADV_RANDOM) == 0, "madvise MADV_RANDOM");
+  recover ("no readahead");
+}
@@ -21,16 +21,19 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/strace.h"
 #endif
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -141,9 +144,31 @@ bss_init (void) {
 	memset (&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Returns true if the CPU can map 1 GB pages (CPUID
+ * 0x80000001:EDX.Page1GB). */
+static bool
+cpu_has_gbpages (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (0x80000000, &eax, &ebx, &ecx, &edx);
+	if (eax < 0x80000001)
+		return false;
+	cpuid (0x80000001, &eax, &ebx, &ecx, &edx);
+	return (edx & (1 << 26)) != 0;
+}
+
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
- * Points base_pml4 to the pml4 it creates. */
+ * Points base_pml4 to the pml4 it creates.
+ *
+ * Physical memory is mapped with the largest pages that fit: 1 GB
+ * pages where the CPU supports them, 2 MB pages otherwise.  Only
+ * the 2 MB blocks that are partly kernel text and partly something
+ * else are mapped with 4 kB pages, so that the text can stay
+ * read-only without forcing the rest onto small pages.
+ *
+ * Every kernel mapping is global, so that it survives the CR3
+ * loads done on each process switch. */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
@@ -151,21 +176,51 @@ paging_init (uint64_t mem_end) {
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	uint64_t text_start = (uint64_t) &start;
+	uint64_t text_end = (uint64_t) &_end_kernel_text;
+	bool gbpages = cpu_has_gbpages ();
+
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
-		perm = PTE_P | PTE_W;
-		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
+		/* 1 GB page: must not contain any kernel text. */
+		if (gbpages && pa % GPGSIZE == 0 && pa + GPGSIZE <= mem_end
+				&& (va + GPGSIZE <= text_start || text_end <= va)) {
+			pte = pml4e_walk_large (pml4, va, GPGSIZE, 1);
+			ASSERT (pte != NULL);
+			*pte = pa | PTE_PS | PTE_G | PTE_P | PTE_W;
+			pa += GPGSIZE;
+			continue;
+		}
+
+		/* 2 MB page: either all text (read-only) or no text at all. */
+		if (pa % HPGSIZE == 0 && pa + HPGSIZE <= mem_end) {
+			bool all_text = text_start <= va && va + HPGSIZE <= text_end;
+			bool no_text = va + HPGSIZE <= text_start || text_end <= va;
+			if (all_text || no_text) {
+				pte = pml4e_walk_large (pml4, va, HPGSIZE, 1);
+				ASSERT (pte != NULL);
+				*pte = pa | PTE_PS | PTE_G | PTE_P
+					| (all_text ? 0 : PTE_W);
+				pa += HPGSIZE;
+				continue;
+			}
+		}
+
+		perm = PTE_G | PTE_P | PTE_W;
+		if (text_start <= va && va < text_end)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
+	pcid_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -226,6 +281,23 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+		else if (!strcmp (name, "-sysstat"))
+			syscall_stats = true;
+		else if (!strcmp (name, "-strace"))
+			strace_prog = value;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fa"))
+			vm_fault_around = atoi (value);
+		else if (!strcmp (name, "-ksm"))
+			vm_ksm_rate = atoi (value);
+		else if (!strcmp (name, "-zswap"))
+			zswap_percent = atoi (value);
+		else if (!strcmp (name, "-wmark")) {
+			char *high = strchr (value, ',');
+			vm_wmark_low = atoi (value);
+			vm_wmark_high = high != NULL ? (unsigned) atoi (high + 1) : vm_wmark_low;
+		}
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -335,6 +407,15 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -sysstat           Count system calls and their cycles.\n"
+			"  -strace=PROG       Trace the system calls of processes running PROG.\n"
+#endif
+#ifdef VM
+			"  -fa=PAGES          Load up to PAGES pages per executable fault.\n"
+			"  -ksm=RATE          Merge identical pages, scanning RATE pages/s.\n"
+			"  -zswap=PCT         Compress swapped pages in up to PCT%% of RAM.\n"
+			"  -wmark=LOW,HIGH    Page out in the background from LOW%% to HIGH%%\n"
+			"                     of RAM free; LOW=0 turns this off.\n"
 #endif
 			);
 	power_off ();
@@ -368,5 +449,9 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	syscall_print_stats ();
+#endif
+#ifdef VM
+	vm_print_stats ();
 #endif
 }
@@ -2,12 +2,150 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers (PCIDs).
+ *
+ * With CR4.PCIDE set, every TLB entry is tagged with the PCID that
+ * was in CR3 when it was loaded, so switching between address
+ * spaces no longer has to flush the TLB.  Each user pml4 gets its
+ * own PCID; base_pml4 uses PCID 0.  Kernel mappings are global
+ * (PTE_G) and survive every CR3 load.
+ *
+ * A pml4 records its PCID in entry PCID_SLOT, which is never
+ * present (user space ends far below it), so the hardware ignores
+ * the other bits.  The entry also carries PCID_STALE, which means
+ * that TLB entries tagged with this PCID may be out of date: the
+ * PCID was just (re)assigned, or a translation of this pml4 was
+ * changed or removed while another address space was active and
+ * invlpg could not reach it.  A stale pml4 is activated with a
+ * flushing CR3 load, and so is any pml4 with PCID 0, which
+ * base_pml4 shares with the user pml4s that found no PCID of their
+ * own.  All other loads set CR3_NOFLUSH. */
+#define PCID_CNT 4096                   /* CR3 holds a 12-bit PCID. */
+#define PCID_SLOT 511                   /* pml4 entry holding the PCID. */
+#define PCID_SHIFT 1                    /* Keeps PTE_P of the slot clear. */
+#define PCID_STALE (1UL << 13)          /* TLB may hold stale entries. */
+#define CR3_NOFLUSH (1UL << 63)         /* Keep this PCID's TLB entries. */
+#define CR4_PGE (1 << 7)                /* Enable global pages. */
+#define CR4_PCIDE (1 << 17)             /* Enable PCIDs. */
+
+static bool pcid_enabled;
+static uint64_t pcid_used[PCID_CNT / 64]; /* Bitmap, bit 0 = PCID 0. */
+static unsigned pcid_next = 1;            /* Next PCID to try. */
+
+/* Enables global pages and, if the CPU has them, PCIDs.  Must be
+ * called with base_pml4 active, because setting CR4.PCIDE requires
+ * CR3's PCID field to be 0. */
+void
+pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	pcid_used[0] = 1;   /* PCID 0 belongs to base_pml4. */
+	pcid_enabled = (ecx & (1 << 17)) != 0;
+	lcr4 (rcr4 () | CR4_PGE | (pcid_enabled ? CR4_PCIDE : 0));
+}
+
+/* Assigns a free PCID to new PML4.  If all are taken, PML4 shares
+ * PCID 0 with base_pml4, and every activation of either flushes. */
+static void
+pcid_alloc (uint64_t *pml4) {
+	unsigned pcid = 0;
+
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		for (unsigned i = 0; i < PCID_CNT - 1; i++) {
+			unsigned cand = pcid_next;
+			pcid_next = pcid_next + 1 < PCID_CNT ? pcid_next + 1 : 1;
+			if (!(pcid_used[cand / 64] & (1UL << (cand % 64)))) {
+				pcid_used[cand / 64] |= 1UL << (cand % 64);
+				pcid = cand;
+				break;
+			}
+		}
+		intr_set_level (old_level);
+	}
+	/* A reused PCID may still tag entries of a dead address space. */
+	pml4[PCID_SLOT] = ((uint64_t) pcid << PCID_SHIFT) | PCID_STALE;
+}
+
+/* Returns the PCID of PML4. */
+static unsigned
+pcid_of (uint64_t *pml4) {
+	return (pml4[PCID_SLOT] & ~PCID_STALE) >> PCID_SHIFT;
+}
+
+/* Releases the PCID of PML4. */
+static void
+pcid_free (uint64_t *pml4) {
+	unsigned pcid = pcid_of (pml4);
+	if (pcid != 0) {
+		enum intr_level old_level = intr_disable ();
+		pcid_used[pcid / 64] &= ~(1UL << (pcid % 64));
+		intr_set_level (old_level);
+	}
+}
+
+/* Makes sure no TLB keeps a stale translation for user page VA of
+ * PML4 after its entry was changed or removed. */
+static void
+pml4_invalidate (uint64_t *pml4, uint64_t va) {
+	if (PTE_ADDR (rcr3 ()) == vtop (pml4))
+		invlpg (va);
+	else if (pcid_enabled)
+		pml4[PCID_SLOT] |= PCID_STALE;
+}
+
+/* Page tables set aside for splitting 2 MB pages, one for every
+ * 2 MB page that is mapped, so that a split never runs out of
+ * memory.  Linked through their first word. */
+static uint64_t *split_reserve;
+
+/* Adds page table PT to the reserve. */
+static void
+split_reserve_put (uint64_t *pt) {
+	enum intr_level old_level = intr_disable ();
+	*(uint64_t **) pt = split_reserve;
+	split_reserve = pt;
+	intr_set_level (old_level);
+}
+
+/* Takes a page table out of the reserve.  The caller must own a
+ * 2 MB mapping, so the reserve cannot be empty. */
+static uint64_t *
+split_reserve_get (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t *pt = split_reserve;
+	ASSERT (pt != NULL);
+	split_reserve = *(uint64_t **) pt;
+	intr_set_level (old_level);
+	return pt;
+}
+
+/* Replaces the 2 MB mapping in *PDE, which covers VA, by a page
+ * table holding 512 equivalent 4 kB entries.  The page table comes
+ * from the reserve that pml4_set_huge_page() filled. */
+static void
+split_huge_pde (uint64_t *pde, const uint64_t va) {
+	uint64_t *pt = split_reserve_get ();
+
+	uint64_t pa = PTE_ADDR (*pde);
+	uint64_t flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+	for (unsigned i = 0; i < HPGCNT; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	/* The TLB may still hold the large translation.  One invlpg
+	 * anywhere inside the 2 MB range drops it. */
+	invlpg (va);
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -22,6 +160,13 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 					return NULL;
 			} else
 				return NULL;
+		} else if ((uint64_t) pte & PTE_PS) {
+			/* VA lies in a 2 MB page.  Lookups get the page-directory
+			 * entry itself, whose P/W/U/A/D bits sit where a PTE's do.
+			 * Callers that want a real 4 kB entry split it first. */
+			if (!create)
+				return &pdp[idx];
+			split_huge_pde (&pdp[idx], va);
 		}
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
@@ -45,6 +190,11 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 					return NULL;
 			} else
 				return NULL;
+		} else if ((uint64_t) pde & PTE_PS) {
+			/* VA lies in a 1 GB page of the direct map.  Lookups get
+			 * the page-directory-pointer entry itself; 1 GB pages are
+			 * never split, so nothing can be created below it. */
+			return create ? NULL : &pdpe[idx];
 		}
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
@@ -60,7 +210,12 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * If VADDR is covered by a 2 MB page, the page-directory entry
+ * (with PTE_PS set) is returned when CREATE is false; when CREATE
+ * is true the huge page is split into 4 kB pages first.  A 1 GB
+ * page likewise yields its page-directory-pointer entry, or a null
+ * pointer when CREATE is true. */
 /*uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);*/
 uint64_t *
 pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
@@ -89,6 +244,36 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the entry that maps the large page of SIZE bytes
+ * containing VA in PML4: the page-directory entry for a 2 MB page
+ * (HPGSIZE) or the page-directory-pointer entry for a 1 GB page
+ * (GPGSIZE).  Missing upper levels are allocated if CREATE is true;
+ * otherwise a null pointer is returned for them.  Never descends
+ * into, or allocates, the level below the returned entry. */
+uint64_t *
+pml4e_walk_large (uint64_t *pml4, const uint64_t va, uint64_t size,
+		int create) {
+	uint64_t *table = pml4;
+	int idx[] = { PML4 (va), PDPE (va), PDX (va) };
+	unsigned depth = size == GPGSIZE ? 1 : 2;
+
+	ASSERT (size == GPGSIZE || size == HPGSIZE);
+	for (unsigned lv = 0; lv < depth; lv++) {
+		uint64_t *e = &table[idx[lv]];
+		if (!(*e & PTE_P)) {
+			if (!create)
+				return NULL;
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return NULL;
+			*e = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		} else if (*e & PTE_PS)
+			return NULL;
+		table = ptov (PTE_ADDR (*e));
+	}
+	return &table[idx[depth]];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -96,8 +281,10 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
-	if (pml4)
+	if (pml4) {
 		memcpy (pml4, base_pml4, PGSIZE);
+		pcid_alloc (pml4);
+	}
 	return pml4;
 }
 
@@ -123,10 +310,18 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
-					pml4_index, pdp_index, i))
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		if (((uint64_t) pte) & PTE_PS) {
+			/* A 2 MB page: FUNC gets the page-directory entry. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
 				return false;
+		} else if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
+					pml4_index, pdp_index, i))
+			return false;
 	}
 	return true;
 }
@@ -136,10 +331,17 @@ pdp_for_each (uint64_t *pdp,
 		pte_for_each_func *func, void *aux, unsigned pml4_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
-			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
-					 aux, pml4_index, i))
+		if (!(((uint64_t) pde) & PTE_P))
+			continue;
+		if (((uint64_t) pde) & PTE_PS) {
+			/* A 1 GB page: FUNC gets the page-directory-pointer entry. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) i << PDPESHIFT));
+			if (!func (&pdp[i], va, aux))
 				return false;
+		} else if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
+					 aux, pml4_index, i))
+			return false;
 	}
 	return true;
 }
@@ -170,7 +372,12 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		if (((uint64_t) pte) & PTE_PS) {
+			palloc_free_multiple ((void *) PTE_ADDR (pte), HPGCNT);
+			palloc_free_page (split_reserve_get ());
+		} else
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -186,6 +393,35 @@ pdpe_destroy (uint64_t *pdpe) {
 	palloc_free_page ((void *) pdpe);
 }
 
+/* Returns the number of pages holding the page tables of the user
+ * part of PML4, PML4 itself included. */
+size_t
+pml4_table_pages (uint64_t *pml4) {
+	size_t cnt = 1;
+	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
+	uint64_t *pdp;
+
+	if (!(((uint64_t) pdpe) & PTE_P))
+		return cnt;
+	pdp = (uint64_t *) PTE_ADDR (pdpe);
+	cnt++;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
+		uint64_t *pde = ptov ((uint64_t *) pdp[i]);
+		uint64_t *pd;
+
+		if (!(((uint64_t) pde) & PTE_P))
+			continue;
+		pd = (uint64_t *) PTE_ADDR (pde);
+		cnt++;
+		for (unsigned j = 0; j < PGSIZE / sizeof(uint64_t *); j++) {
+			uint64_t *pte = ptov ((uint64_t *) pd[j]);
+			if ((((uint64_t) pte) & PTE_P) && !(((uint64_t) pte) & PTE_PS))
+				cnt++;
+		}
+	}
+	return cnt;
+}
+
 /* Destroys pml4e, freeing all the pages it references. */
 void
 pml4_destroy (uint64_t *pml4) {
@@ -197,14 +433,34 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+	pcid_free (pml4);
 	palloc_free_page ((void *) pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, the TLB entries of PML4 are kept unless
+ * they may be stale or PML4 uses PCID 0. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	if (!pcid_enabled) {
+		lcr3 (vtop (pml4 ? pml4 : base_pml4));
+		return;
+	}
+
+	/* base_pml4 maps nothing but global kernel pages, which survive
+	 * the flush, but a user pml4 may have left entries tagged with
+	 * PCID 0 behind. */
+	if (pml4 == NULL || pml4 == base_pml4) {
+		lcr3 (vtop (base_pml4));
+		return;
+	}
+
+	unsigned pcid = pcid_of (pml4);
+	if ((pml4[PCID_SLOT] & PCID_STALE) || pcid == 0) {
+		pml4[PCID_SLOT] &= ~PCID_STALE;
+		lcr3 (vtop (pml4) | pcid);
+	} else
+		lcr3 (vtop (pml4) | pcid | CR3_NOFLUSH);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -218,8 +474,11 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 	/* 만약 해당 가상 메모리가 물리메모리에 매핑되지 않았다면 NULL pointer를 리턴 */
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte)) + hpg_ofs (uaddr);
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
@@ -240,15 +499,81 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		uint64_t old = *pte;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (old & PTE_P)
+			pml4_invalidate (pml4, (uint64_t) upage);
+	}
 	return pte != NULL;
 }
 
+/* Maps the 2 MB user virtual page UPAGE to the physically
+ * contiguous 2 MB frame at kernel virtual address KPAGE with a
+ * single page-directory entry.  Both addresses must be 2 MB
+ * aligned, and no 4 kB page inside UPAGE may be mapped yet.
+ * If WRITABLE is true, the new page is read/write; otherwise it
+ * is read-only.  A page table is set aside with the mapping for
+ * splitting it later.  Returns true if successful, false if memory
+ * allocation failed or the range is already in use. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (hpg_ofs (upage) == 0);
+	ASSERT (hpg_ofs (kpage) == 0);
+	ASSERT (is_user_vaddr ((uint8_t *) upage + HPGSIZE - 1));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *split_pt = palloc_get_page (0);
+	if (split_pt == NULL)
+		return false;
+
+	uint64_t *pde = pml4e_walk_large (pml4, (uint64_t) upage, HPGSIZE, 1);
+	if (pde == NULL)
+		goto fail;
+
+	if (*pde & PTE_P) {
+		if (*pde & PTE_PS)
+			goto fail;
+		/* A page table is in the way.  Reclaim it if nothing in it
+		 * is mapped anymore. */
+		uint64_t *pt = ptov (PTE_ADDR (*pde));
+		for (unsigned i = 0; i < PGSIZE / sizeof (uint64_t); i++)
+			if (pt[i] & PTE_P)
+				goto fail;
+		*pde = 0;
+		palloc_free_page (pt);
+		pml4_invalidate (pml4, (uint64_t) upage);
+	}
+
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	split_reserve_put (split_pt);
+	return true;
+
+fail:
+	palloc_free_page (split_pt);
+	return false;
+}
+
+/* Breaks the 2 MB page of PML4 that covers UPAGE, if any, into
+ * 512 ordinary 4 kB pages with the same frames and permissions,
+ * so that a part of it can be unmapped or protected on its own.
+ * Always succeeds: the page table was set aside when the 2 MB page
+ * was mapped. */
+bool
+pml4_split_huge_page (uint64_t *pml4, void *upage) {
+	ASSERT (is_user_vaddr (upage));
+
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte == NULL || !(*pte & PTE_P) || !(*pte & PTE_PS))
+		return true;
+	return pml4e_walk (pml4, (uint64_t) upage, true) != NULL;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
- * UPAGE need not be mapped. */
+ * UPAGE need not be mapped.  If UPAGE is part of a 2 MB page,
+ * only UPAGE is unmapped; the rest keeps its 4 kB mappings. */
 void
 pml4_clear_page (uint64_t *pml4, void *upage) {
 	uint64_t *pte;
@@ -256,14 +581,39 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (is_user_vaddr (upage));
 
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte != NULL && (*pte & PTE_P) && (*pte & PTE_PS))
+		pte = pml4e_walk (pml4, (uint64_t) upage, true);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_invalidate (pml4, (uint64_t) upage);
 	}
 }
 
+/* Sets the writable bit of the PTE for user page UPAGE in PML4 to
+ * RW and keeps the rest of the entry, including the accessed and
+ * dirty bits.  A 2 MB mapping that covers UPAGE is split first.
+ * Returns false if UPAGE is not mapped. */
+bool
+pml4_set_writable (uint64_t *pml4, void *upage, bool rw) {
+	uint64_t *pte;
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte == NULL || !(*pte & PTE_P))
+		return false;
+	if (*pte & PTE_PS)
+		pte = pml4e_walk (pml4, (uint64_t) upage, true);
+
+	if (rw)
+		*pte |= PTE_W;
+	else
+		*pte &= ~(uint64_t) PTE_W;
+	pml4_invalidate (pml4, (uint64_t) upage);
+	return true;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
  * that is, if the page has been modified since the PTE was
  * installed.
@@ -275,18 +625,20 @@ pml4_is_dirty (uint64_t *pml4, const void *vpage) {
 }
 
 /* Set the dirty bit to DIRTY in the PTE for virtual page VPAGE
- * in PML4. */
+ * in PML4.  A 2 MB mapping that covers VPAGE is split before its
+ * dirty bit is cleared, so that the other 4 kB pages stay dirty. */
 void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte && !dirty && (*pte & PTE_P) && (*pte & PTE_PS))
+		pte = pml4e_walk (pml4, (uint64_t) vpage, true);
 	if (pte) {
 		if (dirty)
 			*pte |= PTE_D;
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate (pml4, (uint64_t) vpage);
 	}
 }
 
@@ -311,7 +663,9 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
+		/* A stale TLB entry only delays setting the bit again, so
+		 * another address space's PCID is not worth marking stale. */
+		if (PTE_ADDR (rcr3 ()) == vtop (pml4))
 			invlpg ((uint64_t) vpage);
 	}
 }
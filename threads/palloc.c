@@ -8,7 +8,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -31,6 +33,7 @@ struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +45,7 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void count_pages (struct pool *, long delta);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +228,13 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool->free_cnt += page_cnt;
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool->free_cnt += page_cnt;
 			}
 		}
 	}
@@ -266,6 +272,8 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR)
+		count_pages (pool, -(long) page_cnt);
 	lock_release (&pool->lock);
 	void *pages;
 
@@ -297,6 +305,56 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Obtains HPGCNT contiguous free pages whose first page is
+   aligned on a 2 MB boundary, suitable for mapping with a single
+   page-directory entry, and returns the kernel virtual address of
+   the first one.  FLAGS are interpreted as in palloc_get_multiple().
+   Free the result with palloc_free_multiple (page, HPGCNT). */
+void *
+palloc_get_huge_page (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t pool_cnt = bitmap_size (pool->used_map);
+	size_t page_idx = (HPGSIZE - hpg_ofs (pool->base)) % HPGSIZE / PGSIZE;
+	void *pages = NULL;
+
+	lock_acquire (&pool->lock);
+	for (; page_idx + HPGCNT <= pool_cnt; page_idx += HPGCNT)
+		if (bitmap_none (pool->used_map, page_idx, HPGCNT)) {
+			bitmap_set_multiple (pool->used_map, page_idx, HPGCNT, true);
+			count_pages (pool, -HPGCNT);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, HPGSIZE);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get_huge_page: out of pages");
+	}
+
+	return pages;
+}
+
+/* Returns the kernel virtual address of the first page of the
+   user pool and stores the number of pages in the pool into
+   *PAGE_CNT.  Every page palloc_get_page (PAL_USER) can return
+   lies in this range, so callers may index per-frame data by
+   page number relative to the returned base. */
+void *
+palloc_user_pool (size_t *page_cnt) {
+	*page_cnt = bitmap_size (user_pool.used_map);
+	return user_pool.base;
+}
+
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free_cnt (void) {
+	return user_pool.free_cnt;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
@@ -321,6 +379,7 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	count_pages (pool, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -357,3 +416,13 @@ page_from_pool (const struct pool *pool, void *page) {
 	size_t end_page = start_page + bitmap_size (pool->used_map);
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Adds DELTA to the number of free pages in POOL.  Pages are
+   freed without taking the pool lock, so the count is updated
+   with interrupts off. */
+static void
+count_pages (struct pool *pool, long delta) {
+	enum intr_level old_level = intr_disable ();
+	pool->free_cnt += delta;
+	intr_set_level (old_level);
+}
@@ -31,6 +31,10 @@
 // 대기중인 쓰레드들이 담겨있는 큐
 static struct list ready_list;
 
+/* List of all processes.  Processes are added to this list
+   when they are first scheduled and removed when they exit. */
+static struct list all_list;
+
 /* 자고 있는 쓰레드들이 담겨 있는 큐 */
 static struct list sleep_list;
 
@@ -131,6 +135,7 @@ void thread_init (void) {
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
 	list_init (&ready_list);
+	list_init (&all_list);
 	list_init (&destruction_req);
 	list_init (&sleep_list);
 	next_tick_to_awake = INT64_MAX;
@@ -224,13 +229,13 @@ tid_t thread_create (const char *name, int priority,
 	list_push_back(&curr->child_list, &t->child_elem);
 
 	/* project 2 : system call */
-	t->file_descriptor_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->file_descriptor_table == NULL) {
+#ifdef USERPROG
+	if (!fdt_init(&t->fdt)) {
 		return TID_ERROR;
 	}
-	t->fdidx = 2; // 0은 stdin, 1은 stdout에 이미 할당
-	t->file_descriptor_table[0] = 1;	// stdin 자리
-	t->file_descriptor_table[1] = 2;	// stdout 자리
+	fdt_set(&t->fdt, 0, (struct file *) 1);	// stdin 자리
+	fdt_set(&t->fdt, 1, (struct file *) 2);	// stdout 자리
+#endif
 
 	t->stdin_count = 1;
 	t->stdout_count = 1;
@@ -321,6 +326,21 @@ tid_t thread_tid (void) {
 	return thread_current ()->tid;
 }
 
+/* Invoke function 'func' on all threads, passing along 'aux'.
+   This function must be called with interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, allelem);
+		func (t, aux);
+	}
+}
+
 /* Deschedules the current thread and destroys it.  Never
    returns to the caller. */
 void thread_exit (void) {
@@ -333,6 +353,7 @@ void thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	list_remove (&thread_current ()->allelem);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -463,6 +484,8 @@ kernel_thread (thread_func *function, void *aux) {
 	- 맨 처음 쓰레드의 상태는 block 상태
 	- 커널 스택 포인터 rsp의 위치도 같이 정해줌. rsp의 값은 커널이 함수 혹은 변수를 쌓을수록 점점 작아짐 */
 static void init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);										// 가리키는 공간이 비어있지 않고
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);	// priority의 값이 제대로 설정되어 있고 (0~63)
 	ASSERT (name != NULL);									// 이름이 들어갈 공간이 있는지 (디버그할 때 사용함)
@@ -493,7 +516,10 @@ static void init_thread (struct thread *t, const char *name, int priority) {
 
 	t->running = NULL;
 	/* --- Project2: User programs - system call --- */
-	
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->allelem);
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
@@ -12,6 +12,16 @@ static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static bool fixup_exception (struct intr_frame *);
+
+/* Exception table, built by the linker from the .ex_table sections.
+   Each entry gives an instruction of the kernel that may fault on a
+   user address and where to continue if it does. */
+struct ex_entry {
+	uintptr_t insn;                 /* Faulting instruction. */
+	uintptr_t fixup;                /* Where to go instead. */
+};
+extern const struct ex_entry _start_ex_table[], _end_ex_table[];
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -145,7 +155,14 @@ page_fault (struct intr_frame *f) {
 	/* For project 3 and later. */
 	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
 		return;
-	else
+#endif
+	/* A bad user address passed to a system call: make the copy
+	   fail, the system call deals with it. */
+	if (!user && fixup_exception (f))
+		return;
+#ifdef VM
+	if (thread_current ()->oom_killed)
+		exit (-1);
 #endif
 	/* Count page faults. */
 	page_fault_cnt++;
@@ -162,3 +179,18 @@ page_fault (struct intr_frame *f) {
 
 }
 
+
+/* If the kernel instruction at F->rip has an entry in the exception
+   table, resumes F at its fixup and returns true.  Otherwise the
+   fault is not an expected one and false is returned. */
+static bool
+fixup_exception (struct intr_frame *f) {
+	const struct ex_entry *e;
+
+	for (e = _start_ex_table; e < _end_ex_table; e++)
+		if (e->insn == f->rip) {
+			f->rip = e->fixup;
+			return true;
+		}
+	return false;
+}
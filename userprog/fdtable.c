@@ -0,0 +1,140 @@
+/* fdtable.c: File descriptor tables.
+
+   A table starts with FDT_INIT_SIZE slots and doubles when a
+   descriptor past its end is needed, up to FDCOUNT_LIMIT.  The
+   lowest free descriptor comes from the two-level bitmap in struct
+   fdtable, and fdt_next() walks the descriptors in use a word of
+   the bitmap at a time, so that fork and exit do not have to look
+   at empty slots. */
+
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <stddef.h>
+#include <string.h>
+#include "threads/malloc.h"
+
+#define ALL_WORDS ((1u << FDT_WORDS) - 1)
+
+/* Initializes FDT as an empty table.  Returns false if memory
+   runs out. */
+bool
+fdt_init (struct fdtable *fdt) {
+	memset (fdt, 0, sizeof *fdt);
+	fdt->files = calloc (FDT_INIT_SIZE, sizeof *fdt->files);
+	if (fdt->files == NULL)
+		return false;
+	fdt->size = FDT_INIT_SIZE;
+	return true;
+}
+
+/* Frees the slots of FDT.  The files in it are not closed. */
+void
+fdt_destroy (struct fdtable *fdt) {
+	free (fdt->files);
+	fdt->files = NULL;
+	fdt->size = 0;
+}
+
+/* Makes sure FDT has a slot for FD.  Returns false if FD is past
+   FDCOUNT_LIMIT or memory runs out. */
+bool
+fdt_grow (struct fdtable *fdt, int fd) {
+	struct file **files;
+	int size;
+
+	if (fd < 0 || fd >= FDCOUNT_LIMIT)
+		return false;
+	if (fd < fdt->size)
+		return true;
+	ASSERT (fdt->size > 0);
+
+	for (size = fdt->size; size <= fd; size *= 2)
+		continue;
+	if (size > FDCOUNT_LIMIT)
+		size = FDCOUNT_LIMIT;
+	files = realloc (fdt->files, size * sizeof *files);
+	if (files == NULL)
+		return false;
+	memset (files + fdt->size, 0, (size - fdt->size) * sizeof *files);
+	fdt->files = files;
+	fdt->size = size;
+	return true;
+}
+
+/* Puts F in the lowest free slot of FDT and returns its fd, or -1
+   if there is none. */
+int
+fdt_alloc (struct fdtable *fdt, struct file *f) {
+	int word, fd;
+
+	if (fdt->full == ALL_WORDS)
+		return -1;
+	word = __builtin_ctz (~fdt->full);
+	fd = word * 64 + __builtin_ctzll (~fdt->used[word]);
+	if (!fdt_grow (fdt, fd))
+		return -1;
+	fdt_set (fdt, fd, f);
+	return fd;
+}
+
+/* Puts F, which must not be null, in slot FD of FDT, replacing
+   what was there.  FDT must have a slot for FD already. */
+void
+fdt_set (struct fdtable *fdt, int fd, struct file *f) {
+	int word = fd / 64;
+
+	ASSERT (fd >= 0 && fd < fdt->size);
+	ASSERT (f != NULL);
+
+	fdt->files[fd] = f;
+	fdt->used[word] |= 1ull << (fd % 64);
+	if (fdt->used[word] == UINT64_MAX)
+		fdt->full |= 1u << word;
+}
+
+/* Returns the file in slot FD of FDT, or NULL. */
+struct file *
+fdt_get (const struct fdtable *fdt, int fd) {
+	if (fd < 0 || fd >= fdt->size)
+		return NULL;
+	return fdt->files[fd];
+}
+
+/* Empties slot FD of FDT. */
+void
+fdt_clear (struct fdtable *fdt, int fd) {
+	int word = fd / 64;
+
+	if (fd < 0 || fd >= fdt->size)
+		return;
+	fdt->files[fd] = NULL;
+	fdt->used[word] &= ~(1ull << (fd % 64));
+	fdt->full &= ~(1u << word);
+}
+
+/* Returns the lowest fd in use in FDT that is at least FD, or -1
+   if there is none. */
+int
+fdt_next (const struct fdtable *fdt, int fd) {
+	int word;
+	uint64_t bits;
+
+	if (fd < 0)
+		fd = 0;
+	if (fd >= fdt->size)
+		return -1;
+	word = fd / 64;
+	bits = fdt->used[word] & (UINT64_MAX << (fd % 64));
+	while (bits == 0) {
+		if (++word * 64 >= fdt->size)
+			return -1;
+		bits = fdt->used[word];
+	}
+	return word * 64 + __builtin_ctzll (bits);
+}
+
+/* Returns true if every fd of FDT up to FDCOUNT_LIMIT is in use. */
+bool
+fdt_full (const struct fdtable *fdt) {
+	return fdt->full == ALL_WORDS;
+}
@@ -19,8 +19,10 @@
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #include "userprog/syscall.h"
+#include "userprog/strace.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "devices/timer.h"
 #endif
 
 /* project2 extra */
@@ -33,6 +35,9 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_spawn (void *);
+static bool duplicate_fdt (struct thread *parent, struct thread *current);
+static bool exec_load (char *file_name, struct intr_frame *if_);
 void argument_stack(char **argv, int argc, struct intr_frame *_if);
 struct thread * get_child (int pid);
 
@@ -81,6 +86,9 @@ process_create_initd (const char *file_name) {
 /* 첫번째 사용자 프로세스를 시작하는 쓰레드 함수 */
 static void
 initd (void *f_name) {
+#ifdef VM
+	thread_current ()->start_tick = timer_ticks ();
+#endif
 	process_init ();
 		
 	if (process_exec (f_name) < 0)
@@ -88,15 +96,62 @@ initd (void *f_name) {
 	NOT_REACHED ();
 }
 
+/* PARENT의 FDT를 CURRENT에 그대로 복사한다. 열린 fd만 비트맵으로 골라서 복사하고,
+ * 같은 파일을 가리키는 fd(dup2)는 복사본도 같은 파일을 가리키게 한다. fork와 spawn이 쓴다. */
+static bool
+duplicate_fdt (struct thread *parent, struct thread *current) {
+	const int DICTLEN = 10;
+	struct dict_elem dup_file_dict[10];
+	int dup_idx = 0;
+	
+	fdt_clear(&current->fdt, 0);
+	fdt_clear(&current->fdt, 1);
+	if (!fdt_grow(&current->fdt, parent->fdt.size - 1))
+		return false;
+	for(int i = fdt_next(&parent->fdt, 0); i >= 0; i = fdt_next(&parent->fdt, i + 1)){
+		struct file *f = fdt_get(&parent->fdt, i);
+		bool is_exist = false;
+		for (int j = 0; j < dup_idx; j++){
+			if (dup_file_dict[j].key == f){
+				fdt_set(&current->fdt, i, (struct file *) dup_file_dict[j].value);
+				is_exist = true;
+				break;
+			}
+		}
+		if (is_exist)
+			continue;
+		
+		struct file *new_f;
+		if (f>2)
+			new_f = file_duplicate(f);
+		else
+			new_f = f;
+
+		if (new_f == NULL)
+			return false;
+		fdt_set(&current->fdt, i, new_f);
+
+		if(dup_idx<DICTLEN){
+			dup_file_dict[dup_idx].key = f;
+			dup_file_dict[dup_idx].value = new_f;
+			dup_idx ++;
+		}
+	}
+
+	current->stdin_count = parent->stdin_count;
+	current->stdout_count = parent->stdout_count;
+	return true;
+}
+
 /* Clones the current process as `name`. Returns the new process's thread id, or
  * TID_ERROR if the thread cannot be created. */
 /* 현재 프로세스를 "name"으로 복제합니다. 새 프로세스의 TID를 반환합니다.
 * 스레드를 만들 수 없는 경우는 TID_ERROR. */
 tid_t
-process_fork (const char *name, struct intr_frame *if_ UNUSED) {
+process_fork (const char *name, struct intr_frame *if_) {
 	/* Clone current thread to new thread.*/
 	struct thread *parent = thread_current(); // 현재 실행 중인 쓰레드!, 하지만 시스템콜로 인해 rsp는 커널 스택을 가리키고 있삼. 따라서 유저스택의 정보를 가지고 있지 않음
-	// memcpy(&parent->parent_if, if_, sizeof(struct intr_frame)); // 유저 스택의 정보(if_)를 부모의 인터럽트 프레임에 넣어주기
+	parent->parent_if = if_; // 자식이 복사를 마칠 때까지 부모는 여기서 기다리므로 if_는 그대로 남아 있다
 
 	tid_t tid = thread_create(name, PRI_DEFAULT, __do_fork, parent); // 전달 받은 thread_name으로 __do_fork()를 진행, thread_current를 줘서 같은 rsi를 공유하게 함.
 	if (tid == TID_ERROR) {
@@ -183,12 +238,16 @@ __do_fork (void *aux) {
 	struct intr_frame *parent_if;
 	bool succ = true;
 
-	parent_if = &parent->parent_if; // 유저 스택의 정보(if_)를 부모의 인터럽트 프레임에 넣어주기
+	parent_if = parent->parent_if; // 부모의 시스템콜 인터럽트 프레임
 
 	/* 1. Read the cpu context to local stack. */
 	memcpy (&if_, parent_if, sizeof (struct intr_frame)); // 자식의 인터럽트 프레임에 부모의 인터럽트 프레임을 복사해줌
 	if_.R.rax = 0; // 자식의 PID 리턴값은 0
-	// current->running = file_duplicate(parent->running);
+	if (parent->running != NULL) {
+		current->running = file_duplicate(parent->running);
+		if (current->running == NULL)
+			goto error;
+	}
 
 	/* 2. Duplicate PT */
 	current->pml4 = pml4_create();
@@ -197,6 +256,9 @@ __do_fork (void *aux) {
 
 	process_activate (current);
 #ifdef VM
+	current->rss_limit = parent->rss_limit;
+	current->oom_adj = parent->oom_adj;
+	current->start_tick = timer_ticks ();
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
@@ -210,43 +272,13 @@ __do_fork (void *aux) {
 	 * TODO:       in include/filesys/file.h. Note that parent should not return
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
-	if (parent->fdidx == FDCOUNT_LIMIT) {
+	if (fdt_full(&parent->fdt)) {
 		goto error;
 	}
-	const int DICTLEN = 10;
-	struct dict_elem dup_file_dict[10];
-	int dup_idx = 0;
-	
-	for(int i = 0; i < FDCOUNT_LIMIT; i++){
-		struct file *f = parent->file_descriptor_table[i];
-		if (f==NULL) continue;
-		bool is_exist = false;
-		for (int j = 0; j < DICTLEN; j++){
-			if (dup_file_dict[j].key == f){
-				current->file_descriptor_table[i] = dup_file_dict[j].value;
-				is_exist = true;
-				break;
-			}
-		}
-		if (is_exist)
-			continue;
-		
-		struct file *new_f;
-		if (f>2)
-			new_f = file_duplicate(f);
-		else
-			new_f = f;
-
-		current->file_descriptor_table[i] = new_f;
-
-		if(dup_idx<DICTLEN){
-			dup_file_dict[dup_idx].key = f;
-			dup_file_dict[dup_idx].value = new_f;
-			dup_idx ++;
-		}
-	}
-
-	current->fdidx = parent->fdidx;
+	if (!duplicate_fdt(parent, current))
+		goto error;
+	if (parent->strace != NULL && !strace_start(current)) // 추적 중인 부모의 자식도 추적
+		goto error;
 	
 	sema_up(&current->fork_sema);
 
@@ -261,19 +293,17 @@ error:
 	// thread_exit ();
 }
 
-/* Switch the current execution context to the f_name.
- * Returns -1 on fail. */
-/* 유저가 입력한 명령어를 수행하도록 프로그램을 메모리에 적재하고 실행하는 함수.*/
-int
-process_exec (void *f_name) {
-   char *file_name = f_name; // f_name은 문자열인데 위에서 (void *)로 넘겨받음! -> 문자열로 인식하기 위해서 char * 로 변환해줘야.
+/* 실행 파일을 현재 프로세스에 적재하고, 유저 모드로 넘어갈 인터럽트 프레임 IF_를 채운다.
+ * FILE_NAME은 인자까지 들어 있는 명령어 페이지. 실패하면 그 페이지를 해제하고 false.
+ * process_exec와 spawn으로 만든 자식이 쓴다. */
+static bool
+exec_load (char *file_name, struct intr_frame *_if) {
    bool success;
 
 	/* 유저 프로세스 작업을 수행하기 위해 intr_frame 내 구조체 멤버에 필요한 정보를 담는다. */
-   struct intr_frame _if;
-   _if.ds = _if.es = _if.ss = SEL_UDSEG;   	// data_segment, more_data_seg, stack_seg
-   _if.cs = SEL_UCSEG;                 		// code_segment
-   _if.eflags = FLAG_IF | FLAG_MBS;      	// cpu_flag
+   _if->ds = _if->es = _if->ss = SEL_UDSEG;   	// data_segment, more_data_seg, stack_seg
+   _if->cs = SEL_UCSEG;                 		// code_segment
+   _if->eflags = FLAG_IF | FLAG_MBS;      	// cpu_flag
 											// SEL_UDSEG : 유저 메모리 데이터 선택자, 유저 메모리에 있는 데이터 세그먼트를 가리키는 주소값.
 											// SEL_UCSEG : 유저 메모리 코드 선택자, 유저 메모리에 있는 코드 세그먼트를 가리키는 주소값
 
@@ -285,26 +315,107 @@ process_exec (void *f_name) {
    // 지운다? => 현재 프로세스에 할당된 page directory를 지운다는 뜻.
    // context switch를 할때 위에서 저장한 _if로 원복하면서 돌아옴
    /* And then load the binary */
-   success = load (file_name, &_if); // file_name, _if를 현재 프로세스에 load.
+   success = load (file_name, _if); // file_name, _if를 현재 프로세스에 load.
    // load에 성공하면 1, 실패하면 0
 //    palloc_free_page(file_name);
 
    if (!success){
 	   palloc_free_page(file_name);
-	   return -1;
+	   return false;
    }
+   strace_exec(file_name); // -strace로 고른 프로그램이면 추적 시작 (load가 file_name을 argv[0]로 잘라둠)
 
    // 디버깅을 위한 툴
-//    hex_dump(_if.rsp, _if.rsp, USER_STACK - _if.rsp, true); // 유저 스택에 담기는 값을 확인함. 메모리 안에 있는 걸 16진수로 값을 보여줌
+//    hex_dump(_if->rsp, _if->rsp, USER_STACK - _if->rsp, true); // 유저 스택에 담기는 값을 확인함. 메모리 안에 있는 걸 16진수로 값을 보여줌
+   return true;
+}
 
-   /* If load failed, quit. */
-   // palloc_free_page (file_name); // file_name: 프로그램 파일 받기 위해 만든 임시변수. 따라서 load 끝나면 메모리 반환.
+/* Switch the current execution context to the f_name.
+ * Returns -1 on fail. */
+/* 유저가 입력한 명령어를 수행하도록 프로그램을 메모리에 적재하고 실행하는 함수.*/
+int
+process_exec (void *f_name) {
+   struct intr_frame _if;
+
+   if (!exec_load (f_name, &_if))
+      return -1;
 
    /* Start switched process. */
    do_iret (&_if);	// 유저 프로세스로 CPU를 넘김
    NOT_REACHED ();
 }
 
+/* process_spawn()이 자식에게 넘겨주는 정보. 부모는 자식이 load를 마칠 때까지
+ * 기다리므로 부모의 스택에 둔다. */
+struct spawn_args {
+	struct thread *parent;          /* spawn을 부른 프로세스 */
+	char *cmdline;                  /* 명령어 페이지, 자식이 가져간다 */
+	bool success;                   /* 자식이 load에 성공했는지 */
+};
+
+/* 명령어 CMDLINE(palloc 페이지, 이 함수가 가져간다)의 실행 파일로 새 자식 프로세스를 만든다.
+ * fork와 달리 부모의 주소 공간을 복사하지 않고 실행 파일에서 바로 load한다.
+ * 자식은 부모의 fd를 물려받는다. 자식이 load를 마칠 때까지만 기다리고,
+ * 자식의 tid를 돌려준다. 실패하면 TID_ERROR. */
+tid_t
+process_spawn (char *cmdline) {
+	struct spawn_args args = { thread_current (), cmdline, false };
+	char name[16];                  /* struct thread의 name 크기 */
+	struct thread *child;
+	tid_t tid;
+
+	/* 쓰레드 이름은 명령어의 첫 단어 */
+	strlcpy (name, cmdline, sizeof name);
+	name[strcspn (name, " ")] = '\0';
+
+	tid = thread_create (name, PRI_DEFAULT, __do_spawn, &args);
+	if (tid == TID_ERROR) {
+		palloc_free_page (cmdline);
+		return TID_ERROR;
+	}
+	child = get_child (tid);
+	sema_down (&child->fork_sema);
+	if (!args.success) {
+		process_wait (tid); // 실패한 자식은 바로 거둔다
+		return TID_ERROR;
+	}
+	return tid;
+}
+
+/* spawn으로 만든 자식이 처음 실행하는 함수. 부모의 fd를 복사하고
+ * 실행 파일을 load한 뒤 부모를 깨우고 유저 모드로 넘어간다. */
+static void
+__do_spawn (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *parent = args->parent;
+	struct thread *current = thread_current ();
+	char *cmdline = args->cmdline;
+	struct intr_frame if_;
+	bool success;
+
+#ifdef VM
+	current->rss_limit = parent->rss_limit;
+	current->oom_adj = parent->oom_adj;
+	current->start_tick = timer_ticks ();
+#endif
+	process_init ();
+
+	success = duplicate_fdt (parent, current)
+		&& (parent->strace == NULL || strace_start (current));
+	if (success)
+		success = exec_load (cmdline, &if_); // 실패하면 cmdline을 해제한다
+	else
+		palloc_free_page (cmdline);
+
+	/* 이 뒤로 args는 부모가 가져가서 쓸 수 없다. */
+	args->success = success;
+	sema_up (&current->fork_sema);
+	if (!success)
+		exit (-1);
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
  * it was terminated by the kernel (i.e. killed due to an
  * exception), returns -1.  If TID is invalid or if it was not a
@@ -350,16 +461,21 @@ process_exit (void) {
 	 * TODO: Implement process termination message (see
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
-	for (int i = 0; i < FDCOUNT_LIMIT; i++){
+	for (int i = fdt_next(&curr->fdt, 0); i >= 0; i = fdt_next(&curr->fdt, i + 1)){
 		close(i);
 	}
-	palloc_free_multiple(curr->file_descriptor_table, FDT_PAGES);
+	fdt_destroy(&curr->fdt);
+	strace_stop(curr); // 기록해둔 시스템콜을 출력
 
+	/* prefaultd가 실행 파일에서 페이지를 읽고 있을 수 있으므로,
+	 * 주소 공간을 먼저 정리(madvise_cancel)한 뒤에 실행 파일을 닫는다. */
+	process_cleanup();
 	if (curr->running != NULL){
 		file_close(curr->running);
 	}
-	
-	process_cleanup();
+#ifdef VM
+	shm_exit(curr); // 만들어 둔 공유 메모리 세그먼트를 놓아준다
+#endif
 
 	sema_up(&curr->wait_sema);
 	
@@ -801,35 +917,20 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		// TODO : 물리 페이지를 할당하고 맵핑하는 부분 삭제 
-		// TODO : page 생성 (malloc)
-		// TODO : page 멤버를 설정, 가상 페이지가 요구될 때, 읽어야할 파일의 오프셋과 사이즈, 마지막에 패딩할 제로 바이트 등등..
-		// TODO : insert_page() 함수를 사용해서 생성한 page_entry를 해시 테이블에 추가 
-		struct segment *seg = calloc(1, sizeof(struct segment));
-		seg->file = file;
-		seg->offset = ofs;
-		seg->page_read_bytes = page_read_bytes;
-		seg->page_zero_bytes = page_zero_bytes;
-
-		void *aux = seg;
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage, writable, lazy_load_segment, aux)){
-			free(seg);
-			return false;
-		}
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;		
-		ofs += page_read_bytes;
-		upage += PGSIZE;
-	}
+	/* The whole segment becomes one area; its pages are created and
+	 * loaded by lazy_load_segment as they are first touched.
+	 * Read-only pages stay backed by the file, so they can be
+	 * dropped instead of swapped and shared with every process
+	 * running the same program.  Pages past the file data are plain
+	 * zeros. */
+	struct vma *vma = vma_map (&thread_current ()->spt, upage,
+			read_bytes + zero_bytes, writable, writable ? VM_ANON : VM_FILE);
+	if (vma == NULL)
+		return false;
+	vma->init = lazy_load_segment;
+	vma->file = file;
+	vma->offset = ofs;
+	vma->read_bytes = read_bytes;
 	return true;
 }
 
@@ -843,7 +944,8 @@ setup_stack (struct intr_frame *if_) {
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */ // do_claim_frame -> initial
 	/* TODO: Your code goes here */
-	if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, 1)){
+	if (vma_map (&thread_current ()->spt, stack_bottom, PGSIZE, true,
+				VM_ANON | VM_MARKER_0) != NULL) {
 		success = vm_claim_page(stack_bottom);
 		if (success){
 			if_->rsp = USER_STACK;
@@ -0,0 +1,129 @@
+/* strace.c: Tracing the system calls of a process.
+
+   A traced process has a page holding a ring of records, one per
+   system call, with the call number, its arguments, its return
+   value and the time stamp counter on entry and on exit.  Once the
+   ring is full the oldest records are overwritten.
+
+   The ring is printed to the console when tracing stops, which is
+   when the process turns it off or exits, one line per record:
+
+       [strace] TID SEQ NR ENTER EXIT RET ARG...
+
+   with RET and the arguments in hex, and EXIT 0 for a call that
+   has not returned.  utils/pintos-strace decodes these lines. */
+
+#include "userprog/strace.h"
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define STRACE_ARGS 6
+
+/* One system call. */
+struct strace_rec {
+	uint32_t nr;                /* System call number. */
+	uint32_t argc;              /* Number of arguments. */
+	uint64_t arg[STRACE_ARGS];  /* Arguments. */
+	uint64_t ret;               /* Return value. */
+	uint64_t enter;             /* Time stamp counter on entry. */
+	uint64_t exit;              /* Time stamp counter on exit, or 0. */
+};
+
+/* Records that fit in the page of a trace. */
+#define STRACE_RECS \
+	((PGSIZE - sizeof (size_t)) / sizeof (struct strace_rec))
+
+/* Trace of a process, one page. */
+struct strace {
+	size_t seq;                 /* Records ever written. */
+	struct strace_rec rec[STRACE_RECS];
+};
+
+const char *strace_prog;
+
+/* Starts tracing the system calls of T, if it is not traced
+   already.  Returns false if memory runs out. */
+bool
+strace_start (struct thread *t) {
+	if (t->strace == NULL) {
+		t->strace = palloc_get_page (0);
+		if (t->strace == NULL)
+			return false;
+		t->strace->seq = 0;
+	}
+	return true;
+}
+
+/* Stops tracing T and prints what was recorded, oldest first. */
+void
+strace_stop (struct thread *t) {
+	struct strace *st = t->strace;
+	size_t seq, first;
+
+	if (st == NULL)
+		return;
+	t->strace = NULL;
+
+	first = st->seq > STRACE_RECS ? st->seq - STRACE_RECS : 0;
+	printf ("[strace] %d begin %s %zu lost\n", t->tid, t->name, first);
+	for (seq = first; seq < st->seq; seq++) {
+		const struct strace_rec *r = &st->rec[seq % STRACE_RECS];
+		char line[256];
+		int len;
+		uint32_t i;
+
+		/* Print each record with one printf(), so that the output
+		   of other threads does not end up in the middle of it. */
+		len = snprintf (line, sizeof line, "[strace] %d %zu %u %llu %llu %#llx",
+				t->tid, seq, r->nr, r->enter, r->exit, r->ret);
+		for (i = 0; i < r->argc; i++)
+			len += snprintf (line + len, sizeof line - len, " %#llx", r->arg[i]);
+		printf ("%s\n", line);
+	}
+	printf ("[strace] %d end\n", t->tid);
+	palloc_free_page (st);
+}
+
+/* Starts tracing the current process if it executes PROG and
+   PROG was given with -strace. */
+void
+strace_exec (const char *prog) {
+	if (strace_prog != NULL && !strcmp (prog, strace_prog))
+		strace_start (thread_current ());
+}
+
+/* Records that T, which is traced, entered system call NR with
+   the ARGC arguments in ARG.  Returns the sequence number of the
+   record, for strace_leave(). */
+size_t
+strace_enter (struct thread *t, uint64_t nr, const uint64_t *arg, int argc) {
+	struct strace *st = t->strace;
+	struct strace_rec *r = &st->rec[st->seq % STRACE_RECS];
+
+	r->nr = nr;
+	r->argc = argc;
+	memcpy (r->arg, arg, argc * sizeof *arg);
+	r->ret = 0;
+	r->exit = 0;
+	r->enter = rdtsc ();
+	return st->seq++;
+}
+
+/* Records that the system call of T recorded as SEQ returned RET.
+   Does nothing if tracing stopped or the record was overwritten
+   in the meantime. */
+void
+strace_leave (struct thread *t, size_t seq, uint64_t ret) {
+	uint64_t now = rdtsc ();
+	struct strace *st = t->strace;
+	struct strace_rec *r;
+
+	if (st == NULL || seq >= st->seq || st->seq - seq > STRACE_RECS)
+		return;
+	r = &st->rec[seq % STRACE_RECS];
+	r->ret = ret;
+	r->exit = now;
+}
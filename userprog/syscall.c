@@ -1,5 +1,6 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -17,6 +18,9 @@
 #include "userprog/process.h"
 #include "threads/synch.h"
 #include "include/vm/vm.h"
+#include "vm/madvise.h"
+#include "userprog/uaccess.h"
+#include "userprog/strace.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -34,12 +38,26 @@ int _write (int fd UNUSED, const void *buffer, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
-tid_t fork (const char *thread_name);
+tid_t fork (const char *thread_name, struct intr_frame *f);
 int exec (const char *file_name);
+int wait (tid_t pid);
+tid_t spawn (const char *path, char *const *argv);
 int dup2(int oldfd, int newfd);
+bool strace(bool enable);
+#ifdef VM
+void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap(void *addr);
+int madvise(void *addr, size_t length, int advice);
+bool memstat(struct memstat *st);
+void memlimit(size_t pages);
+void oomadj(int adj);
+int shm_create(size_t size);
+void *shm_attach(int id, void *addr);
+bool shm_detach(void *addr);
+#endif
 
 /* syscall helper functions */
-void check_address(const uint64_t*);
+static char *copy_in_string(const char *ustr);
 static struct file *process_get_file(int fd);
 int process_add_file(struct file *file);
 void process_close_file(int fd);
@@ -77,119 +95,274 @@ syscall_init (void) {
 }
 
 /* helper functions letsgo ! */
-void check_address(const uint64_t *uaddr){
-	struct thread *cur = thread_current();
-#ifndef VM
-    /* is_user_vaddr : 포인터가 가리키는 주소가 유저영역의 주소인지 확인
-     * pml4_get_page : 유저 가상 주소에 연결된 물리 주소를 반환하는 함수. 
-                       만약 포인터가 가리키는 주소가 매핑되지 않은 영역이면 NULL을 반환함 */
-   /* 잘못된 접근인 경우, 프로세스 종료 */
-	if (uaddr == NULL || !(is_user_vaddr(uaddr)) || pml4_get_page(cur->pml4, uaddr) == NULL)
-	{
-		exit(-1);
-	}
-#else
-	if (uaddr == NULL || !(is_user_vaddr(uaddr)) || spt_find_page(&cur->spt, uaddr) == NULL)
-	{
-		exit(-1);
-	}
-#endif
-}
 
+/* 유저 문자열 USTR을 새 커널 페이지로 복사해서 돌려주는 함수. 미리 주소를 검사하지 않고
+ * 그대로 복사하며, 읽을 수 없는 주소였으면 프로세스를 종료한다.
+ * 한 페이지에 들어가지 않을 만큼 길면 NULL. 받은 페이지는 palloc_free_page로 해제한다. */
+static char *copy_in_string(const char *ustr){
+   char *kstr = palloc_get_page(0);
+   int64_t len;
 
-/* 현재 쓰레드의 FDT테이블에서 첫번째 빈공간을 찾아 파일 객체를 추가해주는 함수 */
-int process_add_file(struct file *f){
-   struct thread *curr = thread_current(); 
-   struct file **curr_fd_table = curr->file_descriptor_table;
-   for (int idx = curr->fdidx; idx < FDCOUNT_LIMIT; idx++){ // 현재 fdidx의 위치부터 FDCOUNT_LI 
-      if(curr_fd_table[idx] == NULL){
-         curr_fd_table[idx] = f;
-         curr->fdidx = idx; // fd의 최대값 + 1
-         return curr->fdidx;
-      }
+   if (kstr == NULL)
+      return NULL;
+   len = strncpy_from_user(kstr, ustr, PGSIZE);
+   if (len < 0){
+      palloc_free_page(kstr);
+      exit(-1);
    }
-   curr->fdidx = FDCOUNT_LIMIT;
-   return -1;
+   if (len == PGSIZE){
+      palloc_free_page(kstr);
+      return NULL;
+   }
+   return kstr;
+}
+
+/* 현재 쓰레드의 FDT테이블에서 가장 작은 빈 fd를 찾아 파일 객체를 추가해주는 함수.
+ * 빈 자리는 비트맵으로 바로 찾고, 테이블이 모자라면 늘린다. */
+int process_add_file(struct file *f){
+   return fdt_alloc(&thread_current()->fdt, f);
 }
 
 struct file *process_get_file (int fd){
-   if (fd < 0 || fd >= FDCOUNT_LIMIT)
-      return NULL;
-   struct file *f = thread_current()->file_descriptor_table[fd];
-   return f;
+   return fdt_get(&thread_current()->fdt, fd);
 }
 
 /* revove the file(corresponding to fd) from the FDT of current process */
 void process_close_file(int fd){
-   if (fd < 0 || fd > FDCOUNT_LIMIT)
-      return NULL;
-   thread_current()->file_descriptor_table[fd] = NULL;
+   fdt_clear(&thread_current()->fdt, fd);
 }
 
 /* helper functions gooooooooooood job */
 
+/* 시스템콜 테이블.
+ * 번호로 바로 찾아가고, 인자는 argc개만 레지스터에서 꺼내 sys_* 함수에 넘겨준다. */
+typedef uint64_t syscall_func (const uint64_t *arg, struct intr_frame *f);
+
+struct syscall {
+   syscall_func *func;              /* 처리 함수, 구현 안 된 번호는 NULL */
+   const char *name;                /* 이름 (통계 출력용) */
+   int argc;                        /* 인자 개수 */
+   bool noret;                      /* 반환값 없음, rax를 건드리지 않는다 */
+};
+
+static uint64_t sys_halt (const uint64_t *arg UNUSED, struct intr_frame *f UNUSED){
+   halt();
+   NOT_REACHED();
+}
+static uint64_t sys_exit (const uint64_t *arg, struct intr_frame *f UNUSED){
+   exit(arg[0]);
+   NOT_REACHED();
+}
+static uint64_t sys_fork (const uint64_t *arg, struct intr_frame *f){
+   // 유저프로그램의 실행 정보는 시스템콜 핸들러로 넘어온 f에 저장되어 있음
+   return fork((const char *) arg[0], f);
+}
+static uint64_t sys_exec (const uint64_t *arg, struct intr_frame *f UNUSED){
+   if (exec((const char *) arg[0]) == -1)
+      exit(-1);
+   NOT_REACHED();
+}
+static uint64_t sys_wait (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return wait(arg[0]);
+}
+static uint64_t sys_create (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return create((const char *) arg[0], arg[1]);
+}
+static uint64_t sys_remove (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return remove((const char *) arg[0]);
+}
+static uint64_t sys_open (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return open((const char *) arg[0]);
+}
+static uint64_t sys_filesize (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return filesize(arg[0]);
+}
+static uint64_t sys_read (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return read(arg[0], (void *) arg[1], arg[2]);
+}
+static uint64_t sys_write (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return write(arg[0], (const void *) arg[1], arg[2]);
+}
+static uint64_t sys_seek (const uint64_t *arg, struct intr_frame *f UNUSED){
+   seek(arg[0], arg[1]);
+   return 0;
+}
+static uint64_t sys_tell (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return tell(arg[0]);
+}
+static uint64_t sys_close (const uint64_t *arg, struct intr_frame *f UNUSED){
+   close(arg[0]);
+   return 0;
+}
+static uint64_t sys_dup2 (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return dup2(arg[0], arg[1]);
+}
+static uint64_t sys_spawn (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return spawn((const char *) arg[0], (char *const *) arg[1]);
+}
+static uint64_t sys_strace (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return strace(arg[0]);
+}
+#ifdef VM
+static uint64_t sys_mmap (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return (uint64_t) mmap((void *) arg[0], arg[1], arg[2], arg[3], arg[4]);
+}
+static uint64_t sys_munmap (const uint64_t *arg, struct intr_frame *f UNUSED){
+   munmap((void *) arg[0]);
+   return 0;
+}
+static uint64_t sys_madvise (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return madvise((void *) arg[0], arg[1], arg[2]);
+}
+static uint64_t sys_memstat (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return memstat((struct memstat *) arg[0]);
+}
+static uint64_t sys_memlimit (const uint64_t *arg, struct intr_frame *f UNUSED){
+   memlimit(arg[0]);
+   return 0;
+}
+static uint64_t sys_oomadj (const uint64_t *arg, struct intr_frame *f UNUSED){
+   oomadj((int) arg[0]);
+   return 0;
+}
+static uint64_t sys_shm_create (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return shm_create(arg[0]);
+}
+static uint64_t sys_shm_attach (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return (uint64_t) shm_attach((int) arg[0], (void *) arg[1]);
+}
+static uint64_t sys_shm_detach (const uint64_t *arg, struct intr_frame *f UNUSED){
+   return shm_detach((void *) arg[0]);
+}
+#endif
+
+static const struct syscall syscall_table[] = {
+   [SYS_HALT]     = { sys_halt,     "halt",     0, true },
+   [SYS_EXIT]     = { sys_exit,     "exit",     1, true },
+   [SYS_FORK]     = { sys_fork,     "fork",     1, false },
+   [SYS_EXEC]     = { sys_exec,     "exec",     1, true },
+   [SYS_WAIT]     = { sys_wait,     "wait",     1, false },
+   [SYS_CREATE]   = { sys_create,   "create",   2, false },
+   [SYS_REMOVE]   = { sys_remove,   "remove",   1, false },
+   [SYS_OPEN]     = { sys_open,     "open",     1, false },
+   [SYS_FILESIZE] = { sys_filesize, "filesize", 1, false },
+   [SYS_READ]     = { sys_read,     "read",     3, false },
+   [SYS_WRITE]    = { sys_write,    "write",    3, false },
+   [SYS_SEEK]     = { sys_seek,     "seek",     2, true },
+   [SYS_TELL]     = { sys_tell,     "tell",     1, false },
+   [SYS_CLOSE]    = { sys_close,    "close",    1, true },
+   [SYS_DUP2]     = { sys_dup2,     "dup2",     2, false },
+   [SYS_STRACE]   = { sys_strace,   "strace",   1, false },
+   [SYS_SPAWN]    = { sys_spawn,    "spawn",    2, false },
+#ifdef VM
+   [SYS_MMAP]     = { sys_mmap,     "mmap",     5, false },
+   [SYS_MUNMAP]   = { sys_munmap,   "munmap",   1, true },
+   [SYS_MADVISE]  = { sys_madvise,  "madvise",  3, false },
+   [SYS_MEMSTAT]  = { sys_memstat,  "memstat",  1, false },
+   [SYS_MEMLIMIT] = { sys_memlimit, "memlimit", 1, true },
+   [SYS_OOMADJ]   = { sys_oomadj,   "oomadj",   1, true },
+   [SYS_SHM_CREATE] = { sys_shm_create, "shm_create", 1, false },
+   [SYS_SHM_ATTACH] = { sys_shm_attach, "shm_attach", 2, false },
+   [SYS_SHM_DETACH] = { sys_shm_detach, "shm_detach", 1, false },
+#endif
+};
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* -sysstat: 시스템콜마다 호출 횟수와 걸린 사이클을 센다. */
+bool syscall_stats;
+
+/* 시스템콜 하나의 통계. exit, halt처럼 돌아오지 않는 호출은 횟수만 센다. */
+struct syscall_stat {
+   uint64_t count;                  /* 호출 횟수 */
+   uint64_t cycles;                 /* 걸린 사이클의 합 */
+   uint64_t max_cycles;             /* 가장 오래 걸린 호출 */
+};
+static struct syscall_stat syscall_stat[SYSCALL_CNT];
+
+/* 통계를 세거나 추적 중일 때 SC를 호출하는 느린 경로. */
+static uint64_t
+syscall_slow (const struct syscall *sc, uint64_t nr, const uint64_t *arg, struct intr_frame *f) {
+   struct thread *curr = thread_current();
+   struct syscall_stat *st = &syscall_stat[nr];
+   bool traced = curr->strace != NULL;
+   size_t seq = 0;
+   uint64_t start, cycles, ret;
+
+   if (traced)
+      seq = strace_enter(curr, nr, arg, sc->argc);
+   start = rdtsc();
+   if (syscall_stats)
+      st->count++;
+   ret = sc->func(arg, f);
+   if (syscall_stats){
+      cycles = rdtsc() - start;
+      st->cycles += cycles;
+      if (cycles > st->max_cycles)
+         st->max_cycles = cycles;
+   }
+   if (traced)
+      strace_leave(curr, seq, ret);
+   return ret;
+}
+
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
-   // TODO: Your implementation goes here.
-   int syscall_num = f->R.rax; // rax: system call number
-   switch(syscall_num){
-      case SYS_HALT:                   /* Halt the operating system. */
-         halt();
-         break;
-      case SYS_EXIT:                   /* Terminate this process. */
-         exit(f->R.rdi);
-         break;    
-      case SYS_FORK:   ;                /* Clone current process. */
-         // 유저프로그램의 실행 정보를 intr_frame에 저장해줌
-         // 시스템콜 핸들러로 넘어온 f에 저장되어 있음
-         struct thread *curr = thread_current();                 
-         memcpy(&curr->parent_if, f, sizeof(struct intr_frame));
-         f->R.rax = fork(f->R.rdi);
-         break;
-      case SYS_EXEC:                   /* Switch current process. */
-         if (exec(f->R.rdi) == -1)
-            exit(-1);
-         break;
-      case SYS_WAIT:                   /* Wait for a child process to die. */
-         f->R.rax = wait(f->R.rdi);
-         break;
-      case SYS_CREATE:                 /* Create a file. */
-         f->R.rax = create(f->R.rdi, f->R.rsi);
-         break;
-      case SYS_REMOVE:                 /* Delete a file. */
-         f->R.rax = remove(f->R.rdi);
-         break;
-      case SYS_OPEN:                   /* Open a file. */
-         f->R.rax = open(f->R.rdi);
-         break;
-      case SYS_FILESIZE:               /* Obtain a file's size. */
-         f->R.rax = filesize(f->R.rdi);
-         break;
-      case SYS_READ:                   /* Read from a file. */
-         f->R.rax = read(f->R.rdi, f->R.rsi, f->R.rdx);
-         break;
-      case SYS_WRITE:                  /* Write to a file. */
-         f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
-         break;
-      case SYS_SEEK:                   /* Change position in a file. */
-         seek(f->R.rdi, f->R.rsi);
-         break;
-      case SYS_TELL:                   /* Report current position in a file. */
-         f->R.rax = tell(f->R.rdi);
-         break;
-      case SYS_CLOSE:                /* Close a file. */
-         close(f->R.rdi);
-         break;
-      case SYS_DUP2:
-         f->R.rax = dup2(f->R.rdi, f->R.rsi);
-         break;
-      default:                   /* call thread_exit() ? */
-         exit(-1);
-         break;
+syscall_handler (struct intr_frame *f) {
+   struct thread *curr = thread_current();
+   uint64_t nr = f->R.rax; // rax: system call number
+   const struct syscall *sc;
+   uint64_t arg[6];
+   uint64_t ret;
+
+#ifdef VM
+   /* 메모리 부족으로 OOM killer에게 선택된 프로세스는 여기서 종료된다. */
+   if (curr->oom_killed)
+      exit(-1);
+#endif
+   if (nr >= SYSCALL_CNT || syscall_table[nr].func == NULL)
+      exit(-1);
+   sc = &syscall_table[nr];
+
+   /* 인자는 rdi, rsi, rdx, r10, r8, r9 순서. 쓰는 것만 꺼낸다. */
+   switch (sc->argc){
+      case 6: arg[5] = f->R.r9;        /* fall through */
+      case 5: arg[4] = f->R.r8;        /* fall through */
+      case 4: arg[3] = f->R.r10;       /* fall through */
+      case 3: arg[2] = f->R.rdx;       /* fall through */
+      case 2: arg[1] = f->R.rsi;       /* fall through */
+      case 1: arg[0] = f->R.rdi;       /* fall through */
+      default: break;
+   }
+
+   if (!syscall_stats && curr->strace == NULL)
+      ret = sc->func(arg, f);          // 통계도 추적도 안 할 때는 바로 호출
+   else
+      ret = syscall_slow(sc, nr, arg, f);
+   if (!sc->noret)
+      f->R.rax = ret;
+#ifdef VM
+   /* 시스템콜 안에서 잠든 사이(wait 등)에 OOM killer에게 선택됐으면 유저로 돌아가지 않는다. */
+   if (curr->oom_killed)
+      exit(-1);
+#endif
+}
+
+/* 시스템콜별 통계를 출력한다. -sysstat일 때만 센다. */
+void
+syscall_print_stats (void) {
+   size_t nr;
+
+   if (!syscall_stats)
+      return;
+   printf ("System calls:\n");
+   for (nr = 0; nr < SYSCALL_CNT; nr++){
+      const struct syscall_stat *st = &syscall_stat[nr];
+      if (st->count == 0)
+         continue;
+      printf ("  %-9s %8llu calls, %12llu cycles avg, %12llu max\n",
+              syscall_table[nr].name, st->count,
+              st->cycles / st->count, st->max_cycles);
    }
-   // printf ("system call!\n");
-   // thread_exit ();
 }
 
 
@@ -201,6 +374,9 @@ void halt(void){
 /* 현재 실행중인 프로세스를 종료시키는 시스템 콜 */
 void exit(int status){
    struct thread *curr = thread_current(); // 실행 중인 스레드 구조체 가져오기
+   /* read/write가 유저 버퍼에 바로 접근하다가 고칠 수 없는 page fault로 종료되는 경우 */
+   if (lock_held_by_current_thread(&filesys_lock))
+      lock_release(&filesys_lock);
    curr->exit_status = status;
    /* status == 0 : 정상 종료 */
    printf("%s: exit(%d)\n", thread_name(), status); // 프로그램이 정상적으로 종료되었는지 확인.
@@ -208,23 +384,19 @@ void exit(int status){
 }
 
 /* Clone current process. */
-tid_t fork (const char *thread_name){
+tid_t fork (const char *thread_name, struct intr_frame *f){
    /* create new process, which is the clone of current process with the name THREAD_NAME*/
-   // 커널영역에서 실행중
-   struct thread *curr = thread_current(); // 부모 쓰레드
-   return process_fork(thread_name, &curr->parent_if);
+   // 커널영역에서 실행중, F는 부모의 유저 레지스터
+   return process_fork(thread_name, f);
    /* must return pid of the child process */
 }
 
 int exec (const char *file){
-   check_address(file);
-   int size = strlen(file) + 1; // 마지막 null 문자를 포함해서 + 1
-   char *fn_copy = palloc_get_page(PAL_ZERO); // page 할당을 하는데, 페이지 전체를 0으로 초기화
-   
+   char *fn_copy = copy_in_string(file); // 유저 문자열을 커널 페이지로 복사 (process_exec가 해제)
+
    if(fn_copy==NULL)
       exit(-1);
 
-   strlcpy(fn_copy, file, size);
    if (process_exec(fn_copy) == -1)
       return -1;
 
@@ -232,32 +404,93 @@ int exec (const char *file){
    return 0;
 }
 
+/* 실행 파일 PATH로 새 자식 프로세스를 만드는 시스템콜. fork+exec와 달리 부모의 주소 공간을 복사하지 않는다.
+ * ARGV는 NULL로 끝나는 인자 배열이고 argv[0] 자리에는 PATH가 들어간다 (NULL이면 인자 없음).
+ * exec처럼 인자는 공백으로 이어 붙이므로 공백이 든 인자는 나뉜다.
+ * 자식은 부모의 fd를 물려받고, 자식이 load를 마치면 자식의 pid를 돌려준다. 실패하면 -1. */
+tid_t spawn (const char *path, char *const *argv){
+   char *cmdline = copy_in_string(path); // 유저 문자열을 커널 페이지로 복사 (process_spawn이 해제)
+   size_t len;
+
+   if (cmdline == NULL)
+      return TID_ERROR;
+   len = strlen(cmdline);
+   for (int i = 0; argv != NULL; i++){
+      char *uarg;
+      int64_t n;
+
+      if (!copy_from_user(&uarg, &argv[i], sizeof uarg)){
+         palloc_free_page(cmdline);
+         exit(-1);
+      }
+      if (uarg == NULL)
+         break;
+      if (i == 0)
+         continue;   // argv[0]은 프로그램 이름이라 건너뛴다. 비어 있는 배열({NULL})이면 위에서 멈춘다.
+
+      /* load()는 인자를 64개까지 받는다. */
+      if (i >= 64 || len + 1 >= PGSIZE){
+         palloc_free_page(cmdline);
+         return TID_ERROR;
+      }
+      cmdline[len++] = ' ';
+      n = strncpy_from_user(cmdline + len, uarg, PGSIZE - len);
+      if (n < 0){
+         palloc_free_page(cmdline);
+         exit(-1);
+      }
+      if ((size_t) n == PGSIZE - len){
+         palloc_free_page(cmdline);
+         return TID_ERROR;
+      }
+      len += n;
+   }
+   return process_spawn(cmdline);
+}
+
 /* Wait for a child process to die. */
 int wait(tid_t pid){
-   process_wait(pid);
+   return process_wait(pid);
 }
 
  /* 파일을 생성하는 시스템 콜 */
 bool create(const char *file, unsigned initial_size){
-   check_address(file); // 포인터가 가리키는 주소가 유저영역의 주소인지 확인
-   return filesys_create(file, initial_size); // 파일 이름 & 크기에 해당하는 파일 생성
+   char *name = copy_in_string(file); // 파일 이름을 커널로 복사, 잘못된 주소면 종료
+   bool success;
+
+   if (name == NULL)
+      return false;
+   success = filesys_create(name, initial_size); // 파일 이름 & 크기에 해당하는 파일 생성
+   palloc_free_page(name);
+   return success;
 }
 
  /* Delete a file. */
 bool remove(const char *file){
-   check_address(file); // 포인터가 가리키는 주소가 유저영역의 주소인지 확인
-   return filesys_remove(file); // 파일 이름에 해당하는 파일을 제거
+   char *name = copy_in_string(file); // 파일 이름을 커널로 복사, 잘못된 주소면 종료
+   bool success;
+
+   if (name == NULL)
+      return false;
+   success = filesys_remove(name); // 파일 이름에 해당하는 파일을 제거
+   palloc_free_page(name);
+   return success;
 }
 /* 파일을 열 때 사용하는 시스템콜*/
 int open (const char *file){
    /* 인자로 들어오는 file = 파일의 이름 및 경로 정보 */
 
-   check_address(file);
+   char *name = copy_in_string(file); // 파일 이름을 커널로 복사, 잘못된 주소면 종료
+   if (name == NULL)
+      return -1;
    lock_acquire(&filesys_lock); // 파일을 접근하는 동안 다른 곳에서 쓰면 안되므로 lock
-   struct file *f = filesys_open(file); // 열고자 하는 파일의 객체 정보를 받아오기
-   if (f == NULL)
+   struct file *f = filesys_open(name); // 열고자 하는 파일의 객체 정보를 받아오기
+   palloc_free_page(name);
+   if (f == NULL){
+      lock_release(&filesys_lock);
       return -1;
-   int fd = process_add_file(f); // 파일 객체를 가리키는 포인터를 FDT에 추가하고, FDT내의 해당 파일이 위치한 fdidx를 리턴
+   }
+   int fd = process_add_file(f); // 파일 객체를 가리키는 포인터를 FDT에 추가하고, FDT내의 해당 파일이 위치한 fd를 리턴
    if (fd == -1)
       file_close(f);
    lock_release(&filesys_lock);
@@ -269,9 +502,10 @@ int filesize (int fd){
    if (f == NULL) return -1;
    return file_length(f);
 }
-/* 해당 파일로부터 값을 읽고, 버퍼에 넣는 시스템콜 */
+/* 해당 파일로부터 값을 읽고, 버퍼에 넣는 시스템콜.
+ * 커널 버퍼를 거치지 않고 유저 버퍼에 바로 읽는다. 먼저 fault_in_user로 버퍼의
+ * 모든 페이지를 쓰기용으로 불러와 보고, 잘못된 주소면 filesys_lock을 잡기 전에 종료한다. */
 int read (int fd, void *buffer, unsigned size){
-   check_address(buffer);
    unsigned char *buf = buffer;
    int readsize;
    struct thread *curr = thread_current();
@@ -281,55 +515,54 @@ int read (int fd, void *buffer, unsigned size){
    if (f == NULL) return -1;
    // if (fd < 0 || fd>= FDCOUNT_LIMIT) return NULL;
    if (f == STDOUT) return -1;
-   
+   if (f == STDIN && curr->stdin_count == 0){
+      NOT_REACHED();
+      process_close_file(fd);
+      return -1;
+   }
+   if (!fault_in_user(buf, size, true))
+      exit(-1);
+
    if (f == STDIN){
-      if (curr->stdin_count == 0){
-         NOT_REACHED();
-         process_close_file(fd);
-         readsize = -1;
-      }
-      else {
-         // fd가 0일 경우 키보드 입력을 받아온다
-         for (readsize = 0; readsize < size; readsize++){
-            char c = input_getc();
-            *buf++ = c;
-            if (c == '\0')
-               break;
-         }
+      // fd가 0일 경우 키보드 입력을 받아온다. '\0'은 버퍼에 넣지만 세지는 않는다
+      for (readsize = 0; (unsigned) readsize < size; readsize++){
+         buf[readsize] = input_getc();
+         if (buf[readsize] == '\0')
+            break;
       }
    }
    else{
       lock_acquire(&filesys_lock); // 파일에 동시접근 일어날 수 있으므로 lock 사용
-      readsize = file_read(f, buffer, size);
+      readsize = file_read(f, buf, size);
       lock_release(&filesys_lock);
    }
    return readsize;
 }
 
-/* 데이터를 기록하는 시스템 콜 */
+/* 데이터를 기록하는 시스템 콜. read와 마찬가지로 유저 버퍼를 불러와 본 뒤 그대로 쓴다. */
 int write (int fd, const void *buffer, unsigned size){
-   check_address(buffer);
+   const unsigned char *buf = buffer;
    struct file *f = process_get_file(fd);
    int writesize;
    struct thread *cur = thread_current();
 
    if (f == NULL) return -1;
    if (f == STDIN) return -1;
+   if (f == STDOUT && cur->stdout_count == 0){
+      NOT_REACHED();
+      process_close_file(fd);
+      return -1;
+   }
+   if (!fault_in_user(buf, size, false))
+      exit(-1);
 
    if (f == STDOUT){
-      if (cur->stdout_count == 0) {
-         NOT_REACHED();
-         process_close_file(fd);
-         writesize = -1;
-      }
-      else{
-         putbuf(buffer, size);// buffer에 들은 size만큼을, 한 번의 호출로 작성해준다.
-         writesize = size;
-      }
+      putbuf((const char *) buf, size);// buffer에 들은 size만큼을, 한 번의 호출로 작성해준다.
+      writesize = size;
    }
    else{
       lock_acquire(&filesys_lock); // 파일에 동시접근 일어날 수 있으므로 lock 사용
-      writesize = file_write(f, buffer, size);
+      writesize = file_write(f, buf, size);
       lock_release(&filesys_lock);
    }
    return writesize;
@@ -390,7 +623,9 @@ int dup2(int oldfd, int newfd)
 	}
 	
 	struct thread *cur = thread_current();
-	struct file **fdt = cur->file_descriptor_table;
+
+	if (!fdt_grow(&cur->fdt, newfd)) // newfd 자리가 없으면 테이블을 늘린다
+		return -1;
 
 	if (file_fd == STDIN) {
       cur->stdin_count++;
@@ -403,6 +638,80 @@ int dup2(int oldfd, int newfd)
    }
    
    close(newfd);
-   fdt[newfd] = file_fd;
+   fdt_set(&cur->fdt, newfd, file_fd);
    return newfd;
-}
\ No newline at end of file
+}
+
+/* 현재 프로세스의 시스템콜 기록을 켜고 끄는 시스템콜. 끌 때와 프로세스가 끝날 때
+ * 기록을 콘솔에 출력한다 (utils/pintos-strace로 읽는다). fork한 자식도 물려받는다. */
+bool strace(bool enable){
+   if (enable)
+      return strace_start(thread_current());
+   strace_stop(thread_current());
+   return true;
+}
+
+#ifdef VM
+/* fd가 가리키는 파일을 addr부터 length 바이트만큼 메모리에 매핑하는 시스템콜 */
+void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
+   struct file *f = process_get_file(fd);
+
+   /* 콘솔(STDIN, STDOUT)은 매핑할 수 없다 */
+   if (f == NULL || (intptr_t) f == STDIN || (intptr_t) f == STDOUT)
+      return NULL;
+   return do_mmap(addr, length, writable, f, offset);
+}
+
+/* addr에서 시작하는 매핑을 해제하는 시스템콜 */
+void munmap (void *addr){
+   do_munmap(addr);
+}
+
+/* addr부터 length 바이트의 메모리를 어떻게 쓸지 커널에 알려주는 시스템콜 */
+int madvise (void *addr, size_t length, int advice){
+   return do_madvise(addr, length, advice);
+}
+
+/* 현재 프로세스의 메모리 사용량(페이지 수)을 st에 채워주는 시스템콜 */
+bool memstat (struct memstat *st){
+   struct memstat buf;
+
+   vm_memstat(&buf);
+   if (!copy_to_user(st, &buf, sizeof buf))
+      exit(-1);
+   return true;
+}
+
+/* 현재 프로세스가 프레임에 올려둘 수 있는 페이지 수를 제한하는 시스템콜.
+ * 0이면 제한이 없다. 한도를 넘으면 자기 페이지부터 내보낸다. fork한 자식도 물려받는다. */
+void memlimit (size_t pages){
+   thread_current()->rss_limit = pages;
+}
+
+/* 메모리가 부족할 때 OOM killer가 쓰는 badness 점수에 adj를 더하는 시스템콜.
+ * OOM_ADJ_MIN이면 절대 죽지 않는다. fork한 자식도 물려받는다. */
+void oomadj (int adj){
+   if (adj < OOM_ADJ_MIN)
+      adj = OOM_ADJ_MIN;
+   if (adj > OOM_ADJ_MAX)
+      adj = OOM_ADJ_MAX;
+   thread_current()->oom_adj = adj;
+}
+
+/* size 바이트짜리 공유 메모리 세그먼트를 만들고 그 id를 돌려주는 시스템콜.
+ * 세그먼트는 붙어 있는 프로세스가 있거나 만든 프로세스가 살아 있는 동안 남는다. */
+int shm_create (size_t size){
+   return do_shm_create(size);
+}
+
+/* id 세그먼트를 addr에 읽기/쓰기로 붙이는 시스템콜. 붙인 프로세스들은 같은 프레임을
+ * 나눠 쓰므로 한쪽이 쓴 내용이 복사 없이 바로 다른 쪽에 보인다. */
+void *shm_attach (int id, void *addr){
+   return do_shm_attach(id, addr);
+}
+
+/* addr에 붙어 있는 세그먼트를 떼어내는 시스템콜 */
+bool shm_detach (void *addr){
+   return do_shm_detach(addr);
+}
+#endif
@@ -0,0 +1,68 @@
+/* uaccess.c: Copying to and from user memory.
+
+   The kernel does not check a user buffer page by page before
+   using it.  It copies with the loops of copy-user.S, which run at
+   memcpy speed; a page that is not loaded yet is faulted in as for
+   the process itself, and an address the process may not access
+   makes the copy fail instead of killing the kernel thread (see
+   page_fault()).  Only the range is checked up front, so that a
+   user pointer cannot reach kernel memory.
+
+   Buffers of read() and write() are not copied at all: they are
+   faulted in with fault_in_user(), one touch per page, and the file
+   system then works on them in place. */
+
+#include "userprog/uaccess.h"
+#include "threads/vaddr.h"
+
+size_t copy_user (void *dst, const void *src, size_t n);
+int64_t strncpy_user (char *dst, const char *src, size_t n);
+int touch_user (const void *addr, size_t n, bool write);
+
+/* Returns true if [UADDR, UADDR + SIZE) lies in user memory. */
+static bool
+is_user_range (const void *uaddr, size_t size) {
+	uint64_t start = (uint64_t) uaddr;
+	return start + size >= start && start + size <= KERN_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns false
+ * if some byte of USRC cannot be read. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	return is_user_range (usrc, size) && copy_user (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns false
+ * if some byte of UDST cannot be written; the bytes before it may
+ * have been written. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	return is_user_range (udst, size) && copy_user (udst, src, size) == 0;
+}
+
+/* Copies the string at user address USRC, null terminator
+ * included, to DST, which has room for SIZE bytes.  Returns the
+ * length of the string, SIZE if it does not fit, or -1 if it cannot
+ * be read. */
+int64_t
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	uint64_t start = (uint64_t) usrc;
+
+	if (start >= KERN_BASE)
+		return -1;
+	/* Never read past the end of user memory. */
+	if (size > KERN_BASE - start)
+		size = KERN_BASE - start;
+	return strncpy_user (dst, usrc, size);
+}
+
+/* Faults in every page of [UADDR, UADDR + SIZE) for reading, or for
+ * writing if WRITE, so that the kernel may then use the range as an
+ * ordinary buffer, e.g. read a file straight into it.  Returns
+ * false if some page may not be accessed that way.  A page that is
+ * evicted again before it is used is just faulted back in. */
+bool
+fault_in_user (const void *uaddr, size_t size, bool write) {
+	return is_user_range (uaddr, size) && touch_user (uaddr, size, write) == 0;
+}
@@ -1,7 +1,17 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/vaddr.h"
+#include "threads/synch.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include <bitmap.h>
+#include <string.h>
+
+/* Number of disk sectors holding one swapped-out page. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -9,6 +19,21 @@ static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
 
+/* Swap slots.  Slot N occupies sectors [N * SECTORS_PER_SLOT,
+ * (N + 1) * SECTORS_PER_SLOT) of swap_disk. */
+static struct bitmap *swap_table;   /* Used slots; NULL if no swap. */
+static uint32_t *swap_refs;         /* Pages referring to each slot. */
+static struct lock swap_lock;       /* Protects swap_table, swap_refs
+                                       and the swap_va and swap_slot
+                                       of every spt. */
+static size_t swap_cursor;          /* Where the next search starts. */
+
+static int swap_slot_alloc (struct thread *owner, void *va);
+static void swap_slot_put (int slot);
+static void swap_slot_free (struct page *page);
+static void swap_write_slot (int slot, const void *page);
+static void swap_read_slot (int slot, void *page);
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -20,8 +45,142 @@ static const struct page_operations anon_ops = {
 void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
-	// struct page* cur_page = thread_current()->spt;
+	lock_init (&swap_lock);
+	swap_disk = disk_get (1, 1);
+	if (swap_disk == NULL)
+		return;
+	swap_table = bitmap_create (disk_size (swap_disk) / SECTORS_PER_SLOT);
+	swap_refs = calloc (bitmap_size (swap_table), sizeof *swap_refs);
+	if (swap_table == NULL || swap_refs == NULL)
+		PANIC ("vm_anon_init: cannot allocate swap table");
+
+	if (zswap_percent > 0) {
+		size_t user_pages;
+		palloc_user_pool (&user_pages);
+		zswap_init (user_pages * PGSIZE / 100 * zswap_percent, swap_write_slot);
+	}
+}
+
+/* Allocates a free swap slot for the page at VA of OWNER, or for a
+ * page of no process if OWNER is null, and returns its number, or
+ * -1 if the swap disk is full or missing.  A page that follows the
+ * last page its process swapped out goes to the slot after that
+ * page's slot if it is free, so that the swap readahead of
+ * vm_load_page() finds them together.  Otherwise the search goes on
+ * from the slot handed out last, so pages evicted one after another
+ * land in consecutive slots and are written in one pass over the
+ * disk. */
+static int
+swap_slot_alloc (struct thread *owner, void *va) {
+	struct supplemental_page_table *spt = owner != NULL ? &owner->spt : NULL;
+	size_t slot = BITMAP_ERROR;
+
+	if (swap_table == NULL)
+		return -1;
+
+	lock_acquire (&swap_lock);
+	if (spt != NULL && spt->swap_slot >= 0
+			&& (uint8_t *) va == (uint8_t *) spt->swap_va + PGSIZE
+			&& (size_t) spt->swap_slot + 1 < bitmap_size (swap_table)
+			&& !bitmap_test (swap_table, spt->swap_slot + 1)) {
+		slot = spt->swap_slot + 1;
+		bitmap_mark (swap_table, slot);
+	}
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip (swap_table, swap_cursor, 1, false);
+	if (slot == BITMAP_ERROR && swap_cursor != 0)
+		slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	if (slot != BITMAP_ERROR) {
+		swap_refs[slot] = 1;
+		swap_cursor = slot + 1;
+		if (spt != NULL) {
+			owner->swap_pages++;
+			spt->swap_va = va;
+			spt->swap_slot = slot;
+		}
+	}
+	lock_release (&swap_lock);
+
+	return slot != BITMAP_ERROR ? (int) slot : -1;
+}
+
+/* Adds a reference to the swap slot of PAGE, for a page that was
+ * forked while its contents were on the swap disk, or that shared
+ * its frame with the page that was swapped out. */
+void
+swap_slot_dup (struct page *page) {
+	int slot = page->anon.slot_number;
+
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_table, slot));
+	ASSERT (swap_refs[slot] < UINT32_MAX);
+	swap_refs[slot]++;
+	page->owner->swap_pages++;
+	lock_release (&swap_lock);
+}
+
+/* Drops a reference to SLOT and returns it to the free pool when
+ * nothing refers to it anymore.  Must be called with swap_lock
+ * held. */
+static void
+swap_slot_put (int slot) {
+	ASSERT (bitmap_test (swap_table, slot));
+	if (--swap_refs[slot] == 0) {
+		zswap_invalidate (slot);
+		bitmap_reset (swap_table, slot);
+	}
+}
+
+/* Drops the reference of PAGE to its swap slot and returns the
+ * slot to the free pool when no page refers to it anymore. */
+static void
+swap_slot_free (struct page *page) {
+	lock_acquire (&swap_lock);
+	page->owner->swap_pages--;
+	swap_slot_put (page->anon.slot_number);
+	lock_release (&swap_lock);
+}
+
+/* Writes the page at KVA to a swap slot of its own and returns the
+ * slot, or -1 if there is no room.  The slot belongs to no process;
+ * shared memory segments keep their pages there (see shm.c). */
+int
+swap_store (const void *kva) {
+	int slot = swap_slot_alloc (NULL, NULL);
+
+	if (slot >= 0 && !zswap_store (slot, kva))
+		swap_write_slot (slot, kva);
+	return slot;
+}
+
+/* Reads SLOT, filled by swap_store(), back into KVA and frees it. */
+void
+swap_load (int slot, void *kva) {
+	if (!zswap_load (slot, kva))
+		swap_read_slot (slot, kva);
+	swap_discard (slot);
+}
+
+/* Frees SLOT, filled by swap_store(), without reading it. */
+void
+swap_discard (int slot) {
+	lock_acquire (&swap_lock);
+	swap_slot_put (slot);
+	lock_release (&swap_lock);
+}
+
+/* Writes PAGE to SLOT on the swap disk, with one disk command. */
+static void
+swap_write_slot (int slot, const void *page) {
+	disk_write_multiple (swap_disk, (disk_sector_t) slot * SECTORS_PER_SLOT,
+			page, SECTORS_PER_SLOT);
+}
+
+/* Reads SLOT from the swap disk into PAGE, with one disk command. */
+static void
+swap_read_slot (int slot, void *page) {
+	disk_read_multiple (swap_disk, (disk_sector_t) slot * SECTORS_PER_SLOT,
+			page, SECTORS_PER_SLOT);
 }
 
 /* Initialize the file mapping */
@@ -34,25 +193,55 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 
 	anon_page->aux_type = type & VM_MARKER_0 ? VM_MARKER_0 : type;
 	anon_page->slot_number = -1;
+	if (type & VM_ZERO)
+		memset (kva, 0, PGSIZE);
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk, or from
+ * zswap if the slot is still cached there. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->slot_number < 0)
+		return false;
+
+	if (!zswap_load (anon_page->slot_number, kva))
+		swap_read_slot (anon_page->slot_number, kva);
+
+	swap_slot_free (page);
+	anon_page->slot_number = -1;
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.  The
+ * slot is allocated even when zswap keeps the page, so it has a
+ * place to go when zswap writes it back.  Called by
+ * vm_evict_frames() without frame_lock. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	int slot = swap_slot_alloc (page->owner, page->va);
+
+	if (slot < 0)
+		return false;
+
+	if (!zswap_store (slot, page->frame->kva))
+		swap_write_slot (slot, page->frame->kva);
+
+	anon_page->slot_number = slot;
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
-	free(page->frame);
+	vm_free_frame (page);
+	if (anon_page->slot_number >= 0) {
+		swap_slot_free (page);
+		anon_page->slot_number = -1;
+	}
 	return;
 }
@@ -1,6 +1,12 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include <string.h>
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -20,39 +26,136 @@ vm_file_init (void) {
 }
 
 /* Initialize the file backed page */
+/* The page's struct segment (uninit aux) says where its contents
+ * come from.  It shares storage with PAGE->file, so it is read
+ * before PAGE->file is written. */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
+	struct segment *seg = page->uninit.aux;
+	struct inode *inode = file_get_inode (seg->file);
+	off_t offset = seg->offset;
+	size_t read_bytes = seg->page_read_bytes;
+
 	/* Set up the handler */
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	file_page->inode = inode_reopen (inode);
+	file_page->offset = offset;
+	file_page->read_bytes = read_bytes;
+	return true;
+}
+
+/* Writes PAGE back to its file if it was modified. */
+static void
+file_backed_write_back (struct page *page) {
+	struct file_page *file_page = &page->file;
+	uint64_t *pml4 = page->owner->pml4;
+
+	if (pml4 == NULL || !pml4_is_dirty (pml4, page->va))
+		return;
+	inode_write_at (file_page->inode, page->frame->kva,
+			file_page->read_bytes, file_page->offset);
+	pml4_set_dirty (pml4, page->va, false);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (inode_read_at (file_page->inode, kva, file_page->read_bytes,
+				file_page->offset) != (off_t) file_page->read_bytes)
+		return false;
+	memset ((uint8_t *) kva + file_page->read_bytes, 0,
+			PGSIZE - file_page->read_bytes);
+	return true;
 }
 
 /* Swap out the page by writeback contents to the file. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	file_backed_write_back (page);
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (vm_pin_page (page)) {
+		file_backed_write_back (page);
+		vm_unpin_page (page);
+	}
+	vm_free_frame (page);
+	inode_close (file_page->inode);
+}
+
+/* Loads a mapped page from its file on first access. */
+static bool
+file_lazy_load (struct page *page, void *aux) {
+	free (aux);
+	return file_backed_swap_in (page, page->frame->kva);
 }
 
 /* Do the mmap */
+/* Maps LENGTH bytes of FILE starting at OFFSET to ADDR.  Pages are
+ * read when first touched; the part of the mapping beyond the end
+ * of the file reads as zeros and is never written back.  The
+ * mapping holds its own reopening of FILE, so closing or removing
+ * the file does not affect it.  Returns ADDR, or NULL if the
+ * arguments are bad or the range overlaps memory already in use. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma;
+	struct file *mfile;
+	off_t file_len;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || offset < 0
+			|| pg_ofs (offset) != 0 || length == 0
+			|| !is_user_vaddr (addr)
+			|| length > (uint64_t) KERN_BASE - (uint64_t) addr)
+		return NULL;
+	file_len = file_length (file);
+	if (file_len == 0)
+		return NULL;
+	mfile = file_reopen (file);
+	if (mfile == NULL)
+		return NULL;
+
+	lock_acquire (&spt->lock);
+	vma = vma_map (spt, addr, length, writable, VM_FILE);
+	if (vma != NULL) {
+		vma->flags = VMA_MMAP;
+		vma->init = file_lazy_load;
+		vma->file = mfile;
+		vma->offset = offset;
+		vma->read_bytes = file_len > offset ? file_len - offset : 0;
+		if (vma->read_bytes > (size_t) (vma->end - vma->start))
+			vma->read_bytes = vma->end - vma->start;
+	}
+	lock_release (&spt->lock);
+	if (vma == NULL) {
+		file_close (mfile);
+		return NULL;
+	}
+	return addr;
 }
 
 /* Do the munmap */
+/* Unmaps the mapping that starts at ADDR, if there is one. */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma;
+
+	lock_acquire (&spt->lock);
+	vma = vma_find (spt, addr);
+	if (vma != NULL && vma->start == addr && (vma->flags & VMA_MMAP))
+		vma_unmap (spt, vma);
+	lock_release (&spt->lock);
 }
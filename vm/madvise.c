@@ -0,0 +1,265 @@
+/* madvise.c: Access hints for user memory.
+ *
+ * MADV_RANDOM and MADV_SEQUENTIAL are remembered per address range
+ * in the supplemental page table and looked up on each fault.
+ * MADV_WILLNEED hands the range to prefaultd, a kernel thread that
+ * loads its pages while the process keeps running, and
+ * MADV_DONTNEED drops the range's pages on the spot. */
+
+#include "vm/madvise.h"
+#include <list.h>
+#include <round.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* A range of pages with a remembered hint.  The ranges of a
+ * process are disjoint and kept in address order. */
+struct vm_hint {
+	struct list_elem elem;      /* Element in spt->hints. */
+	uint8_t *start, *end;       /* Page-aligned range [START, END). */
+	int advice;                 /* MADV_RANDOM or MADV_SEQUENTIAL. */
+};
+
+/* A range waiting to be prefaulted. */
+struct prefault_req {
+	struct list_elem elem;      /* Element in prefault_queue. */
+	struct supplemental_page_table *spt;
+	uint8_t *start, *end;       /* Pages still to load. */
+};
+
+/* Pages prefaultd loads before it lets the next request have a go
+ * and gives the owner a chance at its spt lock. */
+#define PREFAULT_BATCH 16
+
+static struct list prefault_queue;
+static struct lock prefault_lock;       /* Protects the queue and below. */
+static struct condition prefault_ready; /* Queue became non-empty. */
+static struct condition prefault_idle;  /* prefault_busy was cleared. */
+static struct supplemental_page_table *prefault_busy;  /* Being loaded. */
+
+static void prefaultd (void *aux);
+
+void
+madvise_init (void) {
+	list_init (&prefault_queue);
+	lock_init (&prefault_lock);
+	cond_init (&prefault_ready);
+	cond_init (&prefault_idle);
+	if (thread_create ("prefaultd", PRI_DEFAULT, prefaultd, NULL) == TID_ERROR)
+		PANIC ("madvise_init: cannot start prefaultd");
+}
+
+/* Records ADVICE for [START, END) in SPT, replacing older hints for
+ * any part of it.  MADV_NORMAL just clears them.  Returns false if
+ * out of memory. */
+static bool
+set_hint (struct supplemental_page_table *spt, uint8_t *start, uint8_t *end,
+		int advice) {
+	struct vm_hint *hint = NULL, *split = NULL;
+	struct list_elem *e;
+
+	if (advice != MADV_NORMAL && (hint = malloc (sizeof *hint)) == NULL)
+		return false;
+	split = malloc (sizeof *split);
+	if (split == NULL) {
+		free (hint);
+		return false;
+	}
+
+	for (e = list_begin (&spt->hints); e != list_end (&spt->hints); ) {
+		struct vm_hint *h = list_entry (e, struct vm_hint, elem);
+
+		if (h->start >= end)
+			break;
+		e = list_next (e);
+		if (h->end <= start)
+			continue;
+		if (h->start < start && h->end > end) {
+			/* Punch a hole in the middle of H. */
+			*split = *h;
+			split->start = end;
+			list_insert (e, &split->elem);
+			split = NULL;
+			h->end = start;
+			e = list_next (&h->elem);
+			break;
+		} else if (h->start < start)
+			h->end = start;
+		else if (h->end > end) {
+			h->start = end;
+			e = &h->elem;
+			break;
+		} else {
+			list_remove (&h->elem);
+			free (h);
+		}
+	}
+
+	if (hint != NULL) {
+		hint->start = start;
+		hint->end = end;
+		hint->advice = advice;
+		list_insert (e, &hint->elem);
+	}
+	free (split);
+	return true;
+}
+
+/* Returns the hint remembered for VA in SPT, or MADV_NORMAL. */
+int
+madvise_get (struct supplemental_page_table *spt, void *va) {
+	for (struct list_elem *e = list_begin (&spt->hints);
+			e != list_end (&spt->hints); e = list_next (e)) {
+		struct vm_hint *h = list_entry (e, struct vm_hint, elem);
+		if ((uint8_t *) va < h->start)
+			break;
+		if ((uint8_t *) va < h->end)
+			return h->advice;
+	}
+	return MADV_NORMAL;
+}
+
+/* Gives DST, the table of a process being forked from SRC, a copy
+ * of SRC's hints. */
+bool
+madvise_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	for (struct list_elem *e = list_begin (&src->hints);
+			e != list_end (&src->hints); e = list_next (e)) {
+		struct vm_hint *h = list_entry (e, struct vm_hint, elem);
+		struct vm_hint *copy = malloc (sizeof *copy);
+
+		if (copy == NULL)
+			return false;
+		*copy = *h;
+		list_push_back (&dst->hints, &copy->elem);
+	}
+	return true;
+}
+
+/* Queues [START, END) of the current process for prefaultd. */
+static bool
+prefault_range (uint8_t *start, uint8_t *end) {
+	struct prefault_req *req = malloc (sizeof *req);
+
+	if (req == NULL)
+		return false;
+	req->spt = &thread_current ()->spt;
+	req->start = start;
+	req->end = end;
+	lock_acquire (&prefault_lock);
+	list_push_back (&prefault_queue, &req->elem);
+	cond_signal (&prefault_ready, &prefault_lock);
+	lock_release (&prefault_lock);
+	return true;
+}
+
+/* Loads the pages of queued ranges, PREFAULT_BATCH at a time.
+ * While it works on a table, that table is prefault_busy, which
+ * keeps its process from tearing it down (see madvise_cancel). */
+static void
+prefaultd (void *aux UNUSED) {
+	for (;;) {
+		struct prefault_req *req;
+		struct supplemental_page_table *spt;
+
+		lock_acquire (&prefault_lock);
+		while (list_empty (&prefault_queue))
+			cond_wait (&prefault_ready, &prefault_lock);
+		req = list_entry (list_pop_front (&prefault_queue),
+				struct prefault_req, elem);
+		spt = prefault_busy = req->spt;
+		lock_release (&prefault_lock);
+
+		lock_acquire (&spt->lock);
+		for (int i = 0; i < PREFAULT_BATCH && req->start < req->end; i++) {
+			struct page *page = spt_get_page (spt, req->start);
+			if (page != NULL)
+				vm_prefault_page (page);
+			req->start += PGSIZE;
+		}
+		lock_release (&spt->lock);
+
+		lock_acquire (&prefault_lock);
+		if (req->start < req->end)
+			list_push_back (&prefault_queue, &req->elem);
+		else
+			free (req);
+		prefault_busy = NULL;
+		cond_broadcast (&prefault_idle, &prefault_lock);
+		lock_release (&prefault_lock);
+	}
+}
+
+/* Forgets the pending prefaults of SPT, waiting for prefaultd if it
+ * is loading pages into SPT right now.  Called before SPT is torn
+ * down. */
+void
+madvise_cancel (struct supplemental_page_table *spt) {
+	struct list_elem *e;
+
+	lock_acquire (&prefault_lock);
+	while (prefault_busy == spt)
+		cond_wait (&prefault_idle, &prefault_lock);
+	for (e = list_begin (&prefault_queue); e != list_end (&prefault_queue); ) {
+		struct prefault_req *req = list_entry (e, struct prefault_req, elem);
+		e = list_next (e);
+		if (req->spt == spt) {
+			list_remove (&req->elem);
+			free (req);
+		}
+	}
+	lock_release (&prefault_lock);
+}
+
+/* Frees the hints of SPT. */
+void
+madvise_destroy (struct supplemental_page_table *spt) {
+	while (!list_empty (&spt->hints))
+		free (list_entry (list_pop_front (&spt->hints), struct vm_hint, elem));
+}
+
+/* Applies ADVICE to the pages in [ADDR, ADDR + LENGTH) of the
+ * current process.  ADDR must be page-aligned; LENGTH is rounded up
+ * to whole pages.  Returns 0 on success, -1 on a bad argument or if
+ * out of memory. */
+int
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr, *end;
+	bool success = true;
+
+	if (pg_ofs (addr) != 0 || !is_user_vaddr (addr)
+			|| length > (uint64_t) KERN_BASE - (uint64_t) addr)
+		return -1;
+	end = start + ROUND_UP (length, PGSIZE);
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			lock_acquire (&spt->lock);
+			success = set_hint (spt, start, end, advice);
+			lock_release (&spt->lock);
+			break;
+		case MADV_WILLNEED:
+			if (start < end)
+				success = prefault_range (start, end);
+			break;
+		case MADV_DONTNEED:
+			lock_acquire (&spt->lock);
+			for (uint8_t *va = start; va < end; va += PGSIZE) {
+				struct page *page = spt_find_page (spt, va);
+				if (page != NULL)
+					vm_discard_page (page);
+			}
+			lock_release (&spt->lock);
+			break;
+		default:
+			return -1;
+	}
+	return success ? 0 : -1;
+}
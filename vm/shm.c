@@ -0,0 +1,255 @@
+/* shm.c: Shared memory segments.
+ *
+ * shm_create() makes a segment and shm_attach() maps it into the
+ * calling process as an area of VM_SHM pages.  Unlike the pages of
+ * a forked process, which share frames only until one of them
+ * writes, the pages of a segment keep sharing their frame: the
+ * segment remembers the frame of each of its pages, and every
+ * process that faults on the page is mapped to that frame,
+ * writable.  The frame goes to swap like any other when it is
+ * evicted, into a slot that the segment then remembers instead.
+ *
+ * A segment lives while any area maps it, or while its creator has
+ * not exited, so that it can hand the id to a process that attaches
+ * later.  A page whose last mapping goes away keeps its frame for
+ * the next process that attaches. */
+
+#include "vm/shm.h"
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_SHM,
+};
+
+static struct list shm_list;    /* All segments. */
+static struct lock shm_lock;    /* Protects shm_list, the attach_cnt
+                                   and creator of segments, next_id. */
+static int next_id;
+
+/* Initializes the segment list. */
+void
+shm_init (void) {
+	list_init (&shm_list);
+	lock_init (&shm_lock);
+}
+
+/* Sets up PAGE, in an area made by shm_attach(), as a page of the
+ * area's segment.  The contents are brought in by the caller. */
+bool
+shm_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
+	struct vma *vma = page->vma;
+
+	page->operations = &shm_ops;
+	page->shm.shm = vma->shm;
+	page->shm.idx = ((uint8_t *) page->va - vma->start) / PGSIZE;
+	return true;
+}
+
+/* Fills KVA with the contents of PAGE, which no process has in
+ * memory: from swap if the page was evicted, else zeros.  Called
+ * with the segment's lock held. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm_entry *e = &page->shm.shm->pages[page->shm.idx];
+
+	if (e->slot >= 0) {
+		swap_load (e->slot, kva);
+		e->slot = -1;
+	} else
+		memset (kva, 0, PGSIZE);
+	return true;
+}
+
+/* Writes PAGE to swap on behalf of every process mapping its frame.
+ * Called by vm_evict_frames() without frame_lock; it clears the
+ * entry's frame once the write is done. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm_entry *e = &page->shm.shm->pages[page->shm.idx];
+	int slot = swap_store (page->frame->kva);
+
+	if (slot < 0)
+		return false;
+	e->slot = slot;
+	return true;
+}
+
+/* Unmaps PAGE.  Its frame stays with the segment. */
+static void
+shm_destroy (struct page *page) {
+	vm_free_frame (page);
+}
+
+/* Returns the segment with ID, or NULL.  Must be called with
+ * shm_lock held. */
+static struct shm *
+shm_find (int id) {
+	struct list_elem *e;
+
+	for (e = list_begin (&shm_list); e != list_end (&shm_list);
+			e = list_next (e)) {
+		struct shm *shm = list_entry (e, struct shm, elem);
+		if (shm->id == id)
+			return shm;
+	}
+	return NULL;
+}
+
+/* Frees SHM, which is no longer in shm_list, along with the frames
+ * and swap slots holding its pages. */
+static void
+shm_free (struct shm *shm) {
+	for (size_t i = 0; i < shm->page_cnt; i++) {
+		struct shm_entry *e = &shm->pages[i];
+		if (e->frame != NULL)
+			palloc_free_page (e->frame->kva);
+		if (e->slot >= 0)
+			swap_discard (e->slot);
+	}
+	free (shm);
+}
+
+/* Adds an area mapping SHM, for fork. */
+void
+shm_get (struct shm *shm) {
+	lock_acquire (&shm_lock);
+	shm->attach_cnt++;
+	lock_release (&shm_lock);
+}
+
+/* Drops an area mapping SHM, whose pages are already gone, and
+ * frees SHM if it was the last one and the creator has exited. */
+void
+shm_put (struct shm *shm) {
+	bool dead;
+
+	lock_acquire (&shm_lock);
+	ASSERT (shm->attach_cnt > 0);
+	dead = --shm->attach_cnt == 0 && shm->creator == NULL;
+	if (dead)
+		list_remove (&shm->elem);
+	lock_release (&shm_lock);
+	if (dead)
+		shm_free (shm);
+}
+
+/* Drops the hold of T, which is exiting, on the segments it
+ * created.  Those that are not attached anywhere are freed. */
+void
+shm_exit (struct thread *t) {
+	struct list dead;
+	struct list_elem *e;
+
+	list_init (&dead);
+	lock_acquire (&shm_lock);
+	for (e = list_begin (&shm_list); e != list_end (&shm_list); ) {
+		struct shm *shm = list_entry (e, struct shm, elem);
+		e = list_next (e);
+		if (shm->creator != t)
+			continue;
+		shm->creator = NULL;
+		if (shm->attach_cnt == 0) {
+			list_remove (&shm->elem);
+			list_push_back (&dead, &shm->elem);
+		}
+	}
+	lock_release (&shm_lock);
+	while (!list_empty (&dead))
+		shm_free (list_entry (list_pop_front (&dead), struct shm, elem));
+}
+
+/* Creates a segment of SIZE bytes, rounded up to whole pages, and
+ * returns its id, or -1 if SIZE is 0 or too large or out of
+ * memory.  The pages start out zero-filled. */
+int
+do_shm_create (size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	struct shm *shm;
+
+	if (page_cnt == 0 || page_cnt > SHM_MAX_PAGES)
+		return -1;
+	shm = malloc (sizeof *shm + page_cnt * sizeof *shm->pages);
+	if (shm == NULL)
+		return -1;
+	shm->page_cnt = page_cnt;
+	shm->attach_cnt = 0;
+	shm->creator = thread_current ();
+	lock_init (&shm->lock);
+	for (size_t i = 0; i < page_cnt; i++) {
+		shm->pages[i].frame = NULL;
+		shm->pages[i].slot = -1;
+	}
+
+	lock_acquire (&shm_lock);
+	shm->id = next_id++;
+	list_push_back (&shm_list, &shm->elem);
+	lock_release (&shm_lock);
+	return shm->id;
+}
+
+/* Maps the segment with ID, read-write, at ADDR in the current
+ * process and returns ADDR, or NULL if there is no such segment or
+ * the range is not free.  A fork of the process shares the
+ * mapping. */
+void *
+do_shm_attach (int id, void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct shm *shm;
+	struct vma *vma = NULL;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || !is_user_vaddr (addr))
+		return NULL;
+
+	lock_acquire (&shm_lock);
+	shm = shm_find (id);
+	if (shm != NULL)
+		shm->attach_cnt++;
+	lock_release (&shm_lock);
+	if (shm == NULL)
+		return NULL;
+
+	if (shm->page_cnt * PGSIZE <= (uint64_t) KERN_BASE - (uint64_t) addr) {
+		lock_acquire (&spt->lock);
+		vma = vma_map (spt, addr, shm->page_cnt * PGSIZE, true, VM_SHM);
+		if (vma != NULL)
+			vma->shm = shm;
+		lock_release (&spt->lock);
+	}
+	if (vma == NULL) {
+		shm_put (shm);
+		return NULL;
+	}
+	return addr;
+}
+
+/* Unmaps the segment attached at ADDR.  Returns false if no segment
+ * is attached there. */
+bool
+do_shm_detach (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma;
+	bool found;
+
+	lock_acquire (&spt->lock);
+	vma = vma_find (spt, addr);
+	found = vma != NULL && vma->start == addr && vma->shm != NULL;
+	if (found)
+		vma_unmap (spt, vma);
+	lock_release (&spt->lock);
+	return found;
+}
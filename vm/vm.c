@@ -3,12 +3,132 @@
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/zswap.h"
+#include "vm/madvise.h"
 #include "include/threads/vaddr.h"
 #include "include/threads/mmu.h"
+#include "threads/interrupt.h"
 #include "userprog/process.h"
+#include "threads/synch.h"
+#include "filesys/inode.h"
+#include "devices/timer.h"
+#include <stdio.h>
 #include <string.h>
+#include <round.h>
 
-// struct list frame_table;
+/* Frame table: one entry per page of the user pool, indexed by
+ * the page's offset from the start of the pool. */
+static struct frame *frame_table;
+static uint8_t *frame_base;     /* Kernel address of the first frame. */
+static size_t frame_cnt;        /* Number of frames. */
+static size_t clock_hand;       /* Next frame vm_get_victim looks at. */
+
+/* A frame of zeros, mapped read-only by every untouched zero-filled
+ * anonymous page that is read before it is written.  The first
+ * write gives the page a frame of its own (see vm_handle_wp).  The
+ * zero frame is pinned for good, and the pages mapping it are not
+ * linked to it or counted in its map_cnt. */
+static struct frame *zero_frame;
+
+/* Serializes frame allocation, eviction and release.  It is not
+ * held while victims are written out (see vm_evict_frames()); a
+ * page on a frame marked FRAME_EVICT is left alone until
+ * evict_done is signalled, see page_wait_evict(). */
+static struct lock frame_lock;
+static struct condition evict_done;
+static size_t evicting;         /* Frames marked FRAME_EVICT. */
+
+/* Number of frames evicted at once when the user pool runs dry.
+ * Their anonymous pages get consecutive swap slots and are written
+ * back to back; the spare frames serve the next faults without
+ * another trip through the clock. */
+#define EVICT_BATCH 8
+
+/* Swap readahead, in pages.  A fault that brings an anonymous page
+ * back from swap also brings back its neighbours in the process, on
+ * either side, as long as they sit in the neighbouring slots of the
+ * same aligned cluster of this many slots.  anon_swap_out() places
+ * a process's pages that way, and an eviction batch writes them out
+ * together. */
+#define SWAP_READAHEAD EVICT_BATCH
+
+/* Background page-out.  When a frame allocation leaves fewer than
+ * vm_wmark_low percent of the user pool free, kswapd is woken up
+ * and evicts frames, EVICT_BATCH at a time, until vm_wmark_high
+ * percent are free, so that most faults find a free frame without
+ * evicting one themselves.  A low watermark of 0 turns kswapd off.
+ * Set with -wmark=LOW,HIGH. */
+unsigned vm_wmark_low = 1;
+unsigned vm_wmark_high = 3;
+static size_t wmark_low, wmark_high;    /* In frames. */
+static struct semaphore kswapd_wake;
+static bool kswapd_running;             /* Protected by frame_lock. */
+static size_t kswapd_wakeups;           /* Times kswapd was woken. */
+static size_t kswapd_reclaimed;         /* Frames freed by kswapd. */
+static size_t direct_reclaimed;         /* Frames freed by faults. */
+static size_t swap_readaheads;          /* Pages read ahead from swap. */
+static size_t limit_reclaimed;          /* Frames freed by rss limits. */
+
+/* Ticks to wait for a process killed for lack of memory to exit
+ * before another one is killed. */
+#define OOM_WAIT TIMER_FREQ
+static int64_t oom_kill_tick;           /* When the last kill happened. */
+static size_t oom_kills;                /* Processes killed. */
+static size_t oom_reaped;               /* Frames taken from them. */
+
+/* Fault-around window, in pages.  A fault on a lazily loaded
+ * segment page also loads the neighbouring pages of the same
+ * segment that lie in the aligned window around it, with one file
+ * read.  0 or 1 turns this off.  Set with -fa=N. */
+unsigned vm_fault_around = 16;
+
+/* Under MADV_SEQUENTIAL the fault-around window is this many times
+ * larger and starts at the faulting page instead of around it.
+ * Pages that far behind the fault are marked FRAME_RECLAIM. */
+#define SEQ_READAHEAD 4
+
+/* Text cache: frames holding file pages, keyed by the inode,
+ * offset and number of bytes they were read from (the rest of the
+ * page is zeros), so that processes running the same program map a
+ * single copy of its code, and processes mapping the same part of a
+ * file with mmap() share its pages.  An entry lives as long as its
+ * frame holds the page, or until the file is written to: an entry
+ * whose inode_write_gen() has moved on is dropped when it is next
+ * looked up.  Protected by frame_lock. */
+struct text_entry {
+	struct hash_elem elem;
+	struct inode *inode;
+	off_t offset;
+	size_t read_bytes;
+	unsigned gen;                   /* inode_write_gen() of the data. */
+	struct frame *frame;
+};
+static struct hash text_cache;
+
+/* Same-page merging.  ksmd scans the frame table at vm_ksm_rate
+ * frames per second and merges anonymous frames with identical
+ * contents into one frame shared copy-on-write.  Frames seen during
+ * the current pass are kept in ksm_table, keyed by a checksum of
+ * their contents; the table is emptied at the end of each pass, so
+ * stale entries live at most one pass and are checked before use.
+ * Protected by frame_lock. */
+struct ksm_node {
+	struct hash_elem elem;
+	uint64_t sum;                   /* Checksum of the contents. */
+	struct frame *frame;
+};
+unsigned vm_ksm_rate;               /* Frames per second; 0 = off. */
+static struct hash ksm_table;
+static size_t ksm_cursor;           /* Next frame ksmd looks at. */
+static size_t ksm_merged;           /* Frames freed by merging. */
+static size_t ksm_unmerged;         /* Merged pages copied on write. */
+
+static void frame_table_init (void);
+static void oom_kill (void);
+static void kswapd_init (void);
+static void ksm_init (void);
+static hash_hash_func text_hash;
+static hash_less_func text_less;
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -22,7 +142,299 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	// list_init(&frame_table);
+	frame_table_init ();
+	if (vm_wmark_low > 0)
+		kswapd_init ();
+	madvise_init ();
+	shm_init ();
+	if (vm_ksm_rate > 0)
+		ksm_init ();
+}
+
+/* Stores the memory use of T into *ST.  Shared pages are counted
+ * by walking T's pages, so the caller must keep them and their
+ * frames from changing. */
+static void
+memstat_fill (struct thread *t, struct memstat *st) {
+	struct hash_iterator i;
+
+	st->resident = t->rss_pages;
+	st->swapped = t->swap_pages;
+	st->limit = t->rss_limit;
+	st->page_table = t->pml4 != NULL ? pml4_table_pages (t->pml4) : 0;
+	st->shared = 0;
+	if (t->spt.pages == NULL)
+		return;
+	hash_first (&i, t->spt.pages);
+	while (hash_next (&i)) {
+		struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
+		if (p->frame != NULL
+				&& (p->frame == zero_frame || p->frame->map_cnt > 1))
+			st->shared++;
+	}
+}
+
+/* Stores the memory use of the current process into *ST. */
+void
+vm_memstat (struct memstat *st) {
+	struct thread *t = thread_current ();
+
+	lock_acquire (&t->spt.lock);
+	lock_acquire (&frame_lock);
+	memstat_fill (t, st);
+	lock_release (&frame_lock);
+	lock_release (&t->spt.lock);
+}
+
+/* Prints the memory use of T, if it is a user process.  Only called
+ * at shutdown with interrupts off, so no locks are taken. */
+static void
+print_memstat (struct thread *t, void *aux UNUSED) {
+	struct memstat st;
+
+	if (t->pml4 == NULL || t->spt.pages == NULL)
+		return;
+	memstat_fill (t, &st);
+	printf ("Memory: %s (tid %d): %zu resident (%zu shared), %zu swapped, "
+			"%zu page-table pages", t->name, t->tid, st.resident, st.shared,
+			st.swapped, st.page_table);
+	if (st.limit > 0)
+		printf (", limit %zu", st.limit);
+	printf ("\n");
+}
+
+/* Prints virtual memory statistics. */
+void
+vm_print_stats (void) {
+	enum intr_level old_level = intr_disable ();
+	thread_foreach (print_memstat, NULL);
+	intr_set_level (old_level);
+	if (oom_kills > 0)
+		printf ("OOM: %zu processes killed, %zu frames reaped\n",
+				oom_kills, oom_reaped);
+	if (limit_reclaimed > 0)
+		printf ("Limits: %zu frames reclaimed from processes over their limit\n",
+				limit_reclaimed);
+	if (vm_wmark_low > 0)
+		printf ("kswapd: %zu wakeups, %zu frames reclaimed; %zu reclaimed by faults\n",
+				kswapd_wakeups, kswapd_reclaimed, direct_reclaimed);
+	else
+		printf ("Reclaim: %zu frames reclaimed by faults\n", direct_reclaimed);
+	printf ("Swap: %zu pages read ahead\n", swap_readaheads);
+	if (vm_ksm_rate > 0)
+		printf ("KSM: %zu pages merged, %zu unmerged by writes\n",
+				ksm_merged, ksm_unmerged);
+	zswap_print_stats ();
+}
+
+/* Allocates the frame table from the kernel pool, large enough to
+ * cover every page of the user pool. */
+static void
+frame_table_init (void) {
+	size_t pages;
+
+	lock_init (&frame_lock);
+	cond_init (&evict_done);
+	hash_init (&text_cache, text_hash, text_less, NULL);
+	frame_base = palloc_user_pool (&frame_cnt);
+	pages = DIV_ROUND_UP (frame_cnt * sizeof *frame_table, PGSIZE);
+	frame_table = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, pages);
+	for (size_t i = 0; i < frame_cnt; i++)
+		frame_table[i].kva = frame_base + i * PGSIZE;
+
+	zero_frame = vm_frame_of (palloc_get_page (PAL_ASSERT | PAL_USER | PAL_ZERO));
+	zero_frame->pin_cnt = 1;
+	zero_frame->flags = FRAME_ZERO;
+}
+
+/* Returns the frame table entry of user pool page KVA. */
+struct frame *
+vm_frame_of (void *kva) {
+	size_t idx = pg_no (kva) - pg_no (frame_base);
+	ASSERT (idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct text_entry *t = hash_entry (e, struct text_entry, elem);
+	return hash_bytes (&t->inode, sizeof t->inode) ^ hash_int (t->offset)
+		^ hash_int (t->read_bytes);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct text_entry *a = hash_entry (a_, struct text_entry, elem);
+	const struct text_entry *b = hash_entry (b_, struct text_entry, elem);
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->offset != b->offset)
+		return a->offset < b->offset;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* If PAGE is a file page, stores the text cache key of its
+ * contents in KEY and returns true.  Besides program text this
+ * covers mmap()ed pages, so every process mapping the same part of
+ * a file shares one frame. */
+static bool
+text_key (struct page *page, struct text_entry *key) {
+	if (VM_TYPE (page->operations->type) == VM_FILE) {
+		key->inode = page->file.inode;
+		key->offset = page->file.offset;
+		key->read_bytes = page->file.read_bytes;
+		return true;
+	}
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& VM_TYPE (page->uninit.type) == VM_FILE
+			&& page->uninit.aux != NULL) {
+		struct segment *seg = page->uninit.aux;
+		key->inode = file_get_inode (seg->file);
+		key->offset = seg->offset;
+		key->read_bytes = seg->page_read_bytes;
+		return true;
+	}
+	return false;
+}
+
+/* Returns the inode_write_gen() of the file PAGE is read from, or 0
+ * if it is not a file page.  Taken before the page is read, for
+ * text_cache_insert(). */
+static unsigned
+text_gen (struct page *page) {
+	struct text_entry key;
+
+	return text_key (page, &key) ? inode_write_gen (key.inode) : 0;
+}
+
+/* Returns the cached frame holding the data of KEY, or NULL.  An
+ * entry that the file has been written to since is dropped. */
+static struct frame *
+text_cache_find (struct text_entry *key) {
+	struct hash_elem *e = hash_find (&text_cache, &key->elem);
+	struct text_entry *t;
+
+	if (e == NULL)
+		return NULL;
+	t = hash_entry (e, struct text_entry, elem);
+	if (t->gen != inode_write_gen (t->inode)) {
+		hash_delete (&text_cache, &t->elem);
+		t->frame->flags &= ~FRAME_TEXT;
+		free (t);
+		return NULL;
+	}
+	return t->frame;
+}
+
+/* Enters FRAME, which holds PAGE, into the text cache if PAGE is a
+ * file page.  GEN is the text_gen() of PAGE from before its data
+ * was read; if the file was written to since, the data may be
+ * stale and is not cached. */
+static void
+text_cache_insert (struct frame *frame, struct page *page, unsigned gen) {
+	struct text_entry *t, key;
+
+	if (!text_key (page, &key)
+			|| VM_TYPE (page->operations->type) != VM_FILE
+			|| gen != inode_write_gen (key.inode)
+			|| text_cache_find (&key) != NULL)
+		return;
+	t = malloc (sizeof *t);
+	if (t == NULL)
+		return;
+	*t = key;
+	t->gen = gen;
+	t->frame = frame;
+	hash_insert (&text_cache, &t->elem);
+	frame->flags |= FRAME_TEXT;
+}
+
+/* Drops FRAME, whose pages include PAGE, from the text cache. */
+static void
+text_cache_remove (struct frame *frame, struct page *page) {
+	struct text_entry key;
+	struct hash_elem *e;
+
+	if (!(frame->flags & FRAME_TEXT))
+		return;
+	ASSERT (text_key (page, &key));
+	e = hash_delete (&text_cache, &key.elem);
+	ASSERT (e != NULL);
+	free (hash_entry (e, struct text_entry, elem));
+	frame->flags &= ~FRAME_TEXT;
+}
+
+/* Waits until the frame of PAGE, if any, is no longer being
+ * evicted.  Must be called with frame_lock held, which is dropped
+ * while waiting; on return PAGE may have lost its frame. */
+static void
+page_wait_evict (struct page *page) {
+	while (page->frame != NULL && (page->frame->flags & FRAME_EVICT))
+		cond_wait (&evict_done, &frame_lock);
+}
+
+/* Adds PAGE to the pages using FRAME.  Must be called with
+ * frame_lock held, which also protects the owners' rss_pages. */
+static void
+frame_link (struct frame *frame, struct page *page) {
+	page->frame = frame;
+	page->owner->rss_pages++;
+	if (frame == zero_frame)
+		return;
+	page->frame_next = frame->page;
+	frame->page = page;
+	frame->map_cnt++;
+}
+
+/* Removes PAGE from the pages using FRAME. */
+static void
+frame_unlink (struct frame *frame, struct page *page) {
+	struct page **p = &frame->page;
+
+	page->owner->rss_pages--;
+	if (frame == zero_frame) {
+		page->frame = NULL;
+		return;
+	}
+	while (*p != page) {
+		ASSERT (*p != NULL);
+		p = &(*p)->frame_next;
+	}
+	*p = page->frame_next;
+	page->frame_next = NULL;
+	page->frame = NULL;
+	frame->map_cnt--;
+}
+
+/* Unmaps PAGE from its process and drops its use of its frame.
+ * The frame goes back to the user pool once no page uses it,
+ * unless it holds a page of a shared memory segment, which keeps
+ * it until the segment is freed.  Does nothing if PAGE is not
+ * resident. */
+void
+vm_free_frame (struct page *page) {
+	struct frame *frame;
+	uint64_t *pml4 = page->owner->pml4;
+
+	lock_acquire (&frame_lock);
+	page_wait_evict (page);
+	frame = page->frame;
+	if (frame != NULL) {
+		if (pml4 != NULL)
+			pml4_clear_page (pml4, page->va);
+		if (frame->map_cnt == 1)
+			text_cache_remove (frame, page);
+		frame_unlink (frame, page);
+		if (frame->map_cnt == 0 && frame != zero_frame) {
+			frame->pin_cnt = 0;
+			frame->ref = 0;
+			frame->flags = 0;
+			if (VM_TYPE (page->operations->type) != VM_SHM)
+				palloc_free_page (frame->kva);
+		}
+	}
+	lock_release (&frame_lock);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -40,9 +452,15 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
+static struct frame *vm_get_victim (struct thread *owner);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static size_t vm_evict_frames (struct thread *owner, struct frame **frames,
+		size_t cnt);
+static bool vm_load_page (struct page *page, int advice);
+static void vm_swap_readahead (struct page *page, int slot);
+static bool over_rss_limit (struct thread *t);
+static void vm_trim_resident (struct thread *t);
+static void vm_reclaim_behind (struct page *page);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or `vm_alloc_page`. */
@@ -51,9 +469,17 @@ static struct frame *vm_evict_frame (void);
 bool
 vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		vm_initializer *init, void *aux) {
+	return spt_alloc_page (&thread_current ()->spt, type, upage, writable,
+			init, aux);
+}
+
+/* Same as vm_alloc_page_with_initializer(), for the process owning
+ * SPT, which need not be the running one. */
+bool
+spt_alloc_page (struct supplemental_page_table *spt, enum vm_type type,
+		void *upage, bool writable, vm_initializer *init, void *aux) {
 
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
-	struct supplemental_page_table *spt = &thread_current ()->spt;
 	upage = pg_round_down(upage);
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
@@ -65,6 +491,8 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * uninit_new를 호출한 후 필드를 수정해야 합니다. */
 		struct page* new_page = (struct page*)calloc(1,sizeof(struct page));
 		bool (*initializer)(struct page *, enum vm_type, void *);
+		if (new_page == NULL)
+			goto err;
 		switch (VM_TYPE(type)){
 			case VM_ANON :
 				initializer = anon_initializer;
@@ -72,15 +500,22 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 			case VM_FILE :
 				initializer = file_backed_initializer;
 				break;
+			case VM_SHM :
+				initializer = shm_initializer;
+				break;
 			default :
+				free(new_page);
 				goto err;
 		}
 		uninit_new(new_page, upage, init, type, aux, initializer);
 		/* TODO: Insert the page into the spt. */
 		/* 페이지를 spt에 삽입합니다. */
 		new_page->writable = writable;
-		
-		return spt_insert_page(spt, new_page);;
+		new_page->owner = spt->owner;
+
+		if (spt_insert_page(spt, new_page))
+			return true;
+		free(new_page);
 	}
 err:
 	return false;
@@ -96,6 +531,23 @@ spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 	e = hash_find(spt->pages, &page.hash_elem);
 	return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
 }
+
+/* Returns the page at VA in SPT.  A page that was never touched is
+ * created from the area covering VA.  Returns NULL if VA is not
+ * mapped or out of memory. */
+struct page *
+spt_get_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
+	struct vma *vma;
+
+	if (page != NULL)
+		return page;
+	vma = vma_find (spt, va);
+	if (vma == NULL || !vma_alloc_page (spt, vma, pg_round_down (va)))
+		return NULL;
+	return spt_find_page (spt, va);
+}
+
 // struct page *
 // spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 // 	struct page *page = calloc(1, sizeof(struct page));
@@ -113,35 +565,196 @@ bool
 spt_insert_page (struct supplemental_page_table *spt UNUSED, struct page *page UNUSED) {
 	int succ = false;
 	/* TODO: Fill this function. */
-	if (!hash_insert(spt->pages, &page->hash_elem)) // NULL이면 true
+	if (!hash_insert(spt->pages, &page->hash_elem)) { // NULL이면 true
+		page->vma = vma_find (spt, page->va);
+		if (page->vma != NULL)
+			list_push_back (&page->vma->pages, &page->vma_elem);
 		succ = true;
+	}
 
 	return succ;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (spt->pages, &page->hash_elem);
+	if (page->vma != NULL)
+		list_remove (&page->vma_elem);
 	vm_dealloc_page (page);
+}
+
+/* Returns true if any page using FRAME was accessed since the
+ * last call, and clears the accessed bits. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = false;
+
+	for (struct page *p = frame->page; p != NULL; p = p->frame_next)
+		if (pml4_is_accessed (p->owner->pml4, p->va)) {
+			pml4_set_accessed (p->owner->pml4, p->va, false);
+			accessed = true;
+		}
+	return accessed;
+}
+
+/* Returns true if any page using FRAME has written to it. */
+static bool
+frame_is_dirty (struct frame *frame) {
+	for (struct page *p = frame->page; p != NULL; p = p->frame_next)
+		if (pml4_is_dirty (p->owner->pml4, p->va))
+			return true;
+	return false;
+}
+
+/* Maps every page using FRAME.  A page is writable only while it
+ * has FRAME to itself, or if it is a page of a shared memory
+ * segment. */
+static bool
+frame_map (struct frame *frame) {
+	for (struct page *p = frame->page; p != NULL; p = p->frame_next)
+		if (!pml4_set_page (p->owner->pml4, p->va, frame->kva,
+					p->writable && (frame->map_cnt == 1
+						|| VM_TYPE (p->operations->type) == VM_SHM)))
+			return false;
 	return true;
 }
 
 /* Get the struct frame, that will be evicted. */
+/* Second-chance clock over the frame table.  A frame whose page
+ * was accessed since the hand last passed gets its accessed bit
+ * cleared and is skipped.  Among the rest, a clean file-backed page
+ * is taken right away, since it can be dropped without I/O;
+ * otherwise the first unreferenced frame seen in one sweep is
+ * taken.  Frames that a sequential reader has left behind go
+ * before any of these, accessed or not.  Pinned frames are never chosen, and text shared by
+ * several processes only when nothing else is left.
+ * If OWNER is not null, only frames used by OWNER alone are
+ * considered.
+ * Must be called with frame_lock held. */
 static struct frame *
-vm_get_victim (void) {
+vm_get_victim (struct thread *owner) {
 	struct frame *victim = NULL;
+	struct frame *shared_text = NULL;
 	 /* TODO: The policy for eviction is up to you. */
 
-	return victim;
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	for (size_t i = 0; i < 2 * frame_cnt; i++) {
+		struct frame *frame = &frame_table[clock_hand];
+		struct page *page = frame->page;
+
+		if (i == frame_cnt && victim != NULL)
+			break;
+		clock_hand = (clock_hand + 1) % frame_cnt;
+		if (page == NULL || frame->pin_cnt > 0)
+			continue;
+		if (owner != NULL && (frame->map_cnt != 1 || page->owner != owner))
+			continue;
+
+		if ((frame->flags & FRAME_RECLAIM) && frame->map_cnt == 1)
+			return frame;
+		if (frame_test_and_clear_accessed (frame))
+			continue;
+		if ((frame->flags & FRAME_TEXT) && frame->map_cnt > 1) {
+			if (shared_text == NULL)
+				shared_text = frame;
+			continue;
+		}
+		if (page_get_type (page) == VM_FILE && !frame_is_dirty (frame))
+			return frame;
+		if (victim == NULL)
+			victim = frame;
+	}
+
+	return victim != NULL ? victim : shared_text;
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
-static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+/* Takes VICTIM from its pages for eviction: pins it, marks it
+ * FRAME_EVICT and unmaps it, so the owners fault (and wait for the
+ * eviction to end) instead of writing to the page while it is
+ * written out.  The first page writes the frame out on behalf of
+ * all, so it gets the dirty bit of any of them.  Must be called
+ * with frame_lock held. */
+static void
+evict_begin (struct frame *victim) {
+	struct page *page = victim->page, *p;
+	bool dirty = frame_is_dirty (victim);
+
+	victim->pin_cnt++;
+	victim->flags |= FRAME_EVICT;
+	evicting++;
+	text_cache_remove (victim, page);
+	for (p = page; p != NULL; p = p->frame_next)
+		pml4_clear_page (p->owner->pml4, p->va);
+	if (dirty)
+		pml4_set_dirty (page->owner->pml4, page->va, true);
+}
+
+/* Ends the eviction of VICTIM, whose first page was written out if
+ * WRITTEN is true.  Then VICTIM is taken from its pages and true is
+ * returned; otherwise the pages are mapped again.  Must be called
+ * with frame_lock held. */
+static bool
+evict_end (struct frame *victim, bool written) {
+	struct page *page = victim->page, *p;
+
+	victim->pin_cnt--;
+	victim->flags &= ~FRAME_EVICT;
+	evicting--;
+	if (!written) {
+		if (!frame_map (victim))
+			PANIC ("evict_end: cannot remap page");
+		return false;
+	}
+
+	/* The other pages now refer to the same swap slot. */
+	for (p = page->frame_next; p != NULL; p = p->frame_next)
+		if (VM_TYPE (p->operations->type) == VM_ANON) {
+			p->anon.slot_number = page->anon.slot_number;
+			swap_slot_dup (p);
+		}
+	if (VM_TYPE (page->operations->type) == VM_SHM)
+		page->shm.shm->pages[page->shm.idx].frame = NULL;
+	while (victim->page != NULL)
+		frame_unlink (victim, victim->page);
+	victim->ref = 0;
+	victim->flags = 0;
+	return true;
+}
+
+/* Evicts up to CNT frames, at most EVICT_BATCH, and stores them in
+ * FRAMES, unpinned and used by no page.  Returns the number of
+ * frames evicted.  The victims are picked and unmapped with
+ * frame_lock held (see evict_begin()), but the lock is dropped
+ * while they are written out, so faults and allocations elsewhere
+ * go on meanwhile.  OWNER is passed on to vm_get_victim().  Must be
+ * called with frame_lock held. */
+static size_t
+vm_evict_frames (struct thread *owner, struct frame **frames, size_t cnt) {
+	struct frame *victims[EVICT_BATCH];
+	bool written[EVICT_BATCH];
+	size_t victim_cnt = 0, evicted = 0;
+
+	ASSERT (cnt <= EVICT_BATCH);
+	while (victim_cnt < cnt) {
+		struct frame *victim = vm_get_victim (owner);
+		if (victim == NULL)
+			break;
+		evict_begin (victim);
+		victims[victim_cnt++] = victim;
+	}
+	if (victim_cnt == 0)
+		return 0;
 
-	return NULL;
+	lock_release (&frame_lock);
+	for (size_t i = 0; i < victim_cnt; i++)
+		written[i] = swap_out (victims[i]->page);
+	lock_acquire (&frame_lock);
+
+	for (size_t i = 0; i < victim_cnt; i++)
+		if (evict_end (victims[i], written[i]))
+			frames[evicted++] = victims[i];
+	cond_broadcast (&evict_done, &frame_lock);
+	return evicted;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
@@ -152,31 +765,722 @@ vm_evict_frame (void) {
  * 사용 가능한 페이지가 없으면 페이지를 제거하고 반환합니다.
  * 이것은 항상 유효한 주소를 반환합니다.
  * 즉, 사용자 풀 메모리가 가득 찬 경우 이 함수는 프레임을 제거하여 사용 가능한 메모리 공간을 확보합니다. */
+/* The frame is returned pinned; the caller unpins it once the
+ * page contents are in place.  Must be called with frame_lock
+ * held, which is dropped while frames are evicted.  If nothing can
+ * be evicted, or is being evicted, the OOM killer is run and the
+ * allocation retried, with frame_lock dropped while the victim
+ * exits.  Returns NULL if the current process is the one killed;
+ * its fault then fails and it exits.  A kernel thread never runs
+ * the OOM killer; its allocation fails instead. */
 static struct frame *vm_get_frame (void) {
-	struct frame *frame = (struct frame*)calloc(1,sizeof(struct frame));
+	struct frame *victims[EVICT_BATCH];
+	size_t victim_cnt;
+	struct frame *frame;
 	/* TODO: Fill this function. */
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	for (;;) {
+		void *kva = palloc_get_page(PAL_USER); // 물리메모리의 USER_POOL 내의 프레임을 프로세스의 커널 가상 메모리로 할당 및 매핑
+		if (kva != NULL) {
+			frame = vm_frame_of (kva);
+			break;
+		}
+		victim_cnt = vm_evict_frames (NULL, victims, EVICT_BATCH);
+		if (victim_cnt > 0) {
+			frame = victims[0];
+			for (size_t i = 1; i < victim_cnt; i++)
+				palloc_free_page (victims[i]->kva);
+			direct_reclaimed += victim_cnt;
+			break;
+		}
+		/* Frames that others are writing out are about to come free. */
+		if (evicting > 0) {
+			cond_wait (&evict_done, &frame_lock);
+			continue;
+		}
 
-	frame->kva = palloc_get_page(PAL_USER); // 물리메모리의 USER_POOL 내의 프레임을 프로세스의 커널 가상 메모리로 할당 및 매핑
-	if (frame->kva == NULL){
-		PANIC("to do");
+		/* A kernel thread, such as prefaultd, just goes without. */
+		if (thread_current ()->pml4 == NULL)
+			return NULL;
+		if (!thread_current ()->oom_killed)
+			oom_kill ();
+		if (thread_current ()->oom_killed)
+			return NULL;
+		lock_release (&frame_lock);
+		timer_sleep (1);
+		lock_acquire (&frame_lock);
 	}
-	// list_push_back(&frame_table, &frame->frame_elem);
+	ASSERT (frame->page == NULL);
+	frame->pin_cnt = 1;
 
-	// frame->page = NULL;
+	if (vm_wmark_low > 0 && !kswapd_running
+			&& palloc_user_free_cnt () < wmark_low) {
+		kswapd_running = true;
+		sema_up (&kswapd_wake);
+	}
 
 	return frame;
 }
 
+/* Picks the process to kill when memory runs out, see oom_kill(). */
+struct oom_scan {
+	struct thread *victim;          /* Highest score so far. */
+	int score;                      /* Its score. */
+	bool pending;                   /* A killed process is still alive. */
+};
+
+/* Returns the OOM badness score of T: the permille of the user
+ * pool it has resident, plus its oom_adj. */
+static int
+oom_badness (struct thread *t) {
+	return (int) (t->rss_pages * 1000 / frame_cnt) + t->oom_adj;
+}
+
+/* thread_foreach() helper for oom_kill(). */
+static void
+oom_scan_thread (struct thread *t, void *scan_) {
+	struct oom_scan *scan = scan_;
+	int score;
+
+	if (t->pml4 == NULL || t->spt.pages == NULL)
+		return;
+	if (t->oom_killed) {
+		scan->pending = true;
+		return;
+	}
+	if (t->oom_adj <= OOM_ADJ_MIN)
+		return;
+	score = oom_badness (t);
+	/* On a tie, the younger process goes. */
+	if (scan->victim == NULL || score > scan->score
+			|| (score == scan->score && t->start_tick > scan->victim->start_tick)) {
+		scan->victim = t;
+		scan->score = score;
+	}
+}
+
+/* Takes back the frames of VICTIM's anonymous pages at once,
+ * instead of when it exits, since it may sit blocked in the kernel,
+ * in wait() say, for as long as it likes.  The contents are lost,
+ * which does no harm: VICTIM does not run user code again, and the
+ * kernel's copies from its memory fail.  Pinned frames and huge
+ * pages are left for exit to free.  Returns the number of frames
+ * freed.  Must be called with frame_lock held. */
+static size_t
+oom_reap (struct thread *victim) {
+	size_t reaped = 0;
+
+	for (size_t i = 0; i < frame_cnt; i++) {
+		struct frame *frame = &frame_table[i];
+		struct page *p, *next;
+
+		if (frame->page == NULL || frame->pin_cnt > 0
+				|| (frame->flags & FRAME_HUGE))
+			continue;
+		for (p = frame->page; p != NULL; p = next) {
+			next = p->frame_next;
+			if (p->owner != victim
+					|| VM_TYPE (p->operations->type) != VM_ANON)
+				continue;
+			pml4_clear_page (victim->pml4, p->va);
+			frame_unlink (frame, p);
+		}
+		if (frame->page == NULL) {
+			frame->ref = 0;
+			frame->flags = 0;
+			palloc_free_page (frame->kva);
+			reaped++;
+		}
+	}
+	return reaped;
+}
+
+/* Called when no frame can be allocated or evicted.  Marks the
+ * process with the highest badness score to be killed and reaps
+ * its anonymous memory (see oom_reap()); it exits with status -1
+ * the next time it enters or leaves the kernel (see
+ * vm_try_handle_fault() and the system call handler), and the rest
+ * of its frames are freed then.  While a process killed less than
+ * OOM_WAIT ticks ago is still alive, nothing more is killed, so a
+ * single shortage does not take out several processes.  If no
+ * process may be killed, the current one is.  Only user processes
+ * are ever killed.  Must be called with frame_lock held. */
+static void
+oom_kill (void) {
+	struct oom_scan scan = { .victim = NULL, .score = 0, .pending = false };
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	thread_foreach (oom_scan_thread, &scan);
+	intr_set_level (old_level);
+
+	if (scan.pending && timer_elapsed (oom_kill_tick) < OOM_WAIT)
+		return;
+	if (scan.victim == NULL && thread_current ()->pml4 != NULL)
+		scan.victim = thread_current ();
+	if (scan.victim == NULL)
+		return;
+	scan.victim->oom_killed = true;
+	oom_kill_tick = timer_ticks ();
+	oom_kills++;
+	printf ("Out of memory: killed %s (tid %d), score %d, %zu resident pages\n",
+			scan.victim->name, scan.victim->tid, oom_badness (scan.victim),
+			scan.victim->rss_pages);
+	oom_reaped += oom_reap (scan.victim);
+}
+
+/* The page-out thread.  Each time it is woken up, evicts frames,
+ * EVICT_BATCH at a time, until the high watermark is reached or
+ * nothing more can be evicted.  frame_lock is dropped while a
+ * batch is written out and after each batch, so faults get their
+ * turn. */
+static void
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		bool done = false;
+
+		sema_down (&kswapd_wake);
+		kswapd_wakeups++;
+		while (!done) {
+			struct frame *victims[EVICT_BATCH];
+			size_t victim_cnt = 0;
+
+			lock_acquire (&frame_lock);
+			if (palloc_user_free_cnt () >= wmark_high
+					|| (victim_cnt = vm_evict_frames (NULL, victims,
+							EVICT_BATCH)) == 0)
+				done = true;
+			for (size_t i = 0; i < victim_cnt; i++)
+				palloc_free_page (victims[i]->kva);
+			kswapd_reclaimed += victim_cnt;
+			if (done)
+				kswapd_running = false;
+			lock_release (&frame_lock);
+		}
+	}
+}
+
+/* Converts the watermarks to frames and starts kswapd. */
+static void
+kswapd_init (void) {
+	if (vm_wmark_high < vm_wmark_low)
+		vm_wmark_high = vm_wmark_low;
+	wmark_low = DIV_ROUND_UP (frame_cnt * vm_wmark_low, 100);
+	wmark_high = DIV_ROUND_UP (frame_cnt * vm_wmark_high, 100);
+	sema_init (&kswapd_wake, 0);
+	if (thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL) == TID_ERROR)
+		PANIC ("kswapd_init: cannot start kswapd");
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr UNUSED) {
 }
 
 /* Handle the fault on write_protected page */
+/* PAGE is writable but mapped read-only because it shares its
+ * frame copy-on-write.  Gives PAGE a private copy of the frame, or
+ * just makes it writable if no other page uses the frame anymore.
+ * A file page is a shared mapping, so it is always made writable
+ * in place: the write is seen by every mapper and reaches the file
+ * when the frame is written back. */
+static bool
+vm_handle_wp (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+	struct frame *frame, *copy;
+	bool success;
+
+	lock_acquire (&frame_lock);
+	page_wait_evict (page);
+	frame = page->frame;
+	if (frame == NULL) {
+		/* Evicted meanwhile; the retry faults it back in. */
+		lock_release (&frame_lock);
+		return true;
+	}
+
+	if (frame->map_cnt == 1 || VM_TYPE (page->operations->type) == VM_FILE
+			|| VM_TYPE (page->operations->type) == VM_SHM)
+		success = pml4_set_writable (pml4, page->va, true);
+	else {
+		frame->pin_cnt++;
+		copy = vm_get_frame ();
+		frame->pin_cnt--;
+		if (copy == NULL) {
+			lock_release (&frame_lock);
+			return false;
+		}
+		memcpy (copy->kva, frame->kva, PGSIZE);
+		frame_unlink (frame, page);
+		if (frame->flags & FRAME_KSM)
+			ksm_unmerged++;
+		frame_link (copy, page);
+		success = pml4_set_page (pml4, page->va, copy->kva, true);
+		copy->pin_cnt--;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct ksm_node, elem)->sum;
+}
+
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct ksm_node, elem)->sum
+		< hash_entry (b, struct ksm_node, elem)->sum;
+}
+
+static void
+ksm_node_free (struct hash_elem *e, void *aux UNUSED) {
+	free (hash_entry (e, struct ksm_node, elem));
+}
+
+/* Returns true if FRAME holds anonymous memory that may be merged. */
+static bool
+ksm_eligible (struct frame *frame) {
+	return frame->page != NULL && frame->pin_cnt == 0
+		&& !(frame->flags & (FRAME_HUGE | FRAME_TEXT))
+		&& VM_TYPE (frame->page->operations->type) == VM_ANON;
+}
+
+/* Maps every page using FRAME read-only, so its contents cannot
+ * change behind the scanner's back.  A later write goes through
+ * vm_handle_wp. */
+static void
+ksm_write_protect (struct frame *frame) {
+	for (struct page *p = frame->page; p != NULL; p = p->frame_next)
+		pml4_set_writable (p->owner->pml4, p->va, false);
+}
+
+/* Undoes ksm_write_protect() for a frame that turned out not to
+ * match, if its page has it to itself and may write to it. */
+static void
+ksm_unprotect (struct frame *frame) {
+	struct page *p = frame->page;
+
+	if (frame->map_cnt == 1 && p->writable)
+		pml4_set_writable (p->owner->pml4, p->va, true);
+}
+
+/* Looks for a frame with the same contents as FRAME and, if there
+ * is one, moves the pages of FRAME over to it and frees FRAME.
+ * Frames are checksummed while still writable, so a frame that is
+ * being written costs nothing but the checksum; only when the
+ * checksum matches another frame are both write-protected and
+ * compared in full, which catches any write made in between.
+ * Must be called with frame_lock held. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct ksm_node *node, key;
+	struct hash_elem *e;
+	struct frame *dup;
+
+	if (!ksm_eligible (frame))
+		return;
+	key.sum = hash_bytes (frame->kva, PGSIZE);
+	e = hash_find (&ksm_table, &key.elem);
+	if (e == NULL) {
+		node = malloc (sizeof *node);
+		if (node != NULL) {
+			node->sum = key.sum;
+			node->frame = frame;
+			hash_insert (&ksm_table, &node->elem);
+		}
+		return;
+	}
+
+	node = hash_entry (e, struct ksm_node, elem);
+	dup = node->frame;
+	if (dup == frame || !ksm_eligible (dup)) {
+		node->frame = frame;
+		return;
+	}
+	ksm_write_protect (frame);
+	ksm_write_protect (dup);
+	if (memcmp (dup->kva, frame->kva, PGSIZE)) {
+		ksm_unprotect (frame);
+		ksm_unprotect (dup);
+		return;
+	}
+
+	while (frame->page != NULL) {
+		struct page *p = frame->page;
+		frame_unlink (frame, p);
+		frame_link (dup, p);
+		pml4_set_page (p->owner->pml4, p->va, dup->kva, false);
+	}
+	dup->flags |= FRAME_KSM;
+	frame->ref = 0;
+	frame->flags = 0;
+	palloc_free_page (frame->kva);
+	ksm_merged++;
+}
+
+/* The same-page merging thread.  Wakes up ten times a second and
+ * scans a tenth of vm_ksm_rate frames each time. */
+static void
+ksmd (void *aux UNUSED) {
+	size_t batch = vm_ksm_rate / 10 > 0 ? vm_ksm_rate / 10 : 1;
+
+	for (;;) {
+		timer_sleep (TIMER_FREQ / 10);
+		lock_acquire (&frame_lock);
+		for (size_t i = 0; i < batch; i++) {
+			ksm_scan_frame (&frame_table[ksm_cursor]);
+			if (++ksm_cursor == frame_cnt) {
+				ksm_cursor = 0;
+				hash_clear (&ksm_table, ksm_node_free);
+			}
+		}
+		lock_release (&frame_lock);
+	}
+}
+
+/* Starts the same-page merging thread. */
+static void
+ksm_init (void) {
+	hash_init (&ksm_table, ksm_hash, ksm_less, NULL);
+	if (thread_create ("ksmd", PRI_MIN, ksmd, NULL) == TID_ERROR)
+		PANIC ("ksm_init: cannot start ksmd");
+}
+
+/* Returns true if PAGE is an untouched, zero-filled anonymous
+ * page. */
+static bool
+is_zero_page (struct page *page) {
+	return page != NULL
+		&& VM_TYPE (page->operations->type) == VM_UNINIT
+		&& VM_TYPE (page->uninit.type) == VM_ANON
+		&& (page->uninit.type & VM_ZERO)
+		&& page->uninit.init == NULL;
+}
+
+/* Returns true if PAGE is untouched and has permission WRITABLE,
+ * so that it may become part of a huge page: a zero-filled
+ * anonymous page, or an mmap()ed page whose data has not been read
+ * yet. */
+static bool
+is_huge_candidate (struct page *page, bool writable) {
+	if (page == NULL || page->writable != writable)
+		return false;
+	if (is_zero_page (page))
+		return true;
+	return page->vma != NULL && (page->vma->flags & VMA_MMAP)
+		&& VM_TYPE (page->operations->type) == VM_UNINIT
+		&& VM_TYPE (page->uninit.type) == VM_FILE
+		&& page->uninit.aux != NULL;
+}
+
+/* Maps PAGE, an untouched zero-filled anonymous page that is being
+ * read, to the shared zero frame.  The page is mapped read-only, so
+ * that the first write faults and gets a frame of its own.  Returns
+ * true if PAGE was mapped this way. */
+static bool
+vm_claim_zero_page (struct page *page) {
+	void *aux;
+	bool success;
+
+	if (!is_zero_page (page))
+		return false;
+
+	lock_acquire (&frame_lock);
+	success = pml4_set_page (page->owner->pml4, page->va, zero_frame->kva, false);
+	if (success) {
+		/* Without VM_ZERO, so the zero frame is left alone. */
+		aux = page->uninit.aux;
+		page->uninit.page_initializer (page, page->uninit.type & ~VM_ZERO,
+				zero_frame->kva);
+		free (aux);
+		frame_link (zero_frame, page);
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Tries to back the whole 2 MB-aligned block around PAGE with a
+ * single huge page.  This only works if every 4 kB page of the
+ * block is a huge page candidate with the same permission, none of
+ * its file data is in the text cache already, and a physically
+ * contiguous 2 MB frame is free.  The frame is filled before
+ * anything is mapped or linked, so that a failure leaves the pages
+ * as they were.  Returns true if PAGE got mapped this way. */
+static bool
+vm_claim_huge_page (struct page *page) {
+	struct thread *t = page->owner;
+	struct vma *vma = page->vma;
+	uint8_t *base = hpg_round_down (page->va);
+	unsigned gen = 0;
+	uint8_t *kva;
+
+	/* The block must lie in the zero-filled part of PAGE's area,
+	 * or anywhere in an mmap() area. */
+	if (vma == NULL || base < vma->start || base + HPGSIZE > vma->end
+			|| (!(vma->flags & VMA_MMAP)
+				&& (size_t) (base - vma->start) < vma->read_bytes))
+		return false;
+	for (size_t i = 0; i < HPGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		if (p != NULL && !is_huge_candidate (p, page->writable))
+			return false;
+	}
+
+	for (size_t i = 0; i < HPGCNT; i++)
+		if (!is_huge_candidate (spt_get_page (&t->spt, base + i * PGSIZE),
+					page->writable))
+			return false;
+	lock_acquire (&frame_lock);
+	for (size_t i = 0; i < HPGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		struct text_entry key;
+
+		if (text_key (p, &key) && text_cache_find (&key) != NULL) {
+			lock_release (&frame_lock);
+			return false;
+		}
+	}
+	lock_release (&frame_lock);
+
+	kva = palloc_get_huge_page (PAL_USER | PAL_ZERO);
+	if (kva == NULL)
+		return false;
+	if (vma->file != NULL)
+		gen = inode_write_gen (file_get_inode (vma->file));
+	for (size_t i = 0; i < HPGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		struct segment *seg = p->uninit.aux;
+
+		if (VM_TYPE (p->uninit.type) == VM_FILE
+				&& file_read_at (seg->file, kva + i * PGSIZE,
+					seg->page_read_bytes, seg->offset)
+				!= (off_t) seg->page_read_bytes) {
+			palloc_free_multiple (kva, HPGCNT);
+			return false;
+		}
+	}
+	if (!pml4_set_huge_page (t->pml4, base, kva, page->writable)) {
+		palloc_free_multiple (kva, HPGCNT);
+		return false;
+	}
+
+	/* Nothing can fail from here on.  The frame is already zeroed,
+	 * so zero-filled pages are set up without VM_ZERO. */
+	for (size_t i = 0; i < HPGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		void *aux = p->uninit.aux;
+
+		p->uninit.page_initializer (p, p->uninit.type & ~VM_ZERO,
+				kva + i * PGSIZE);
+		free (aux);
+	}
+	lock_acquire (&frame_lock);
+	for (size_t i = 0; i < HPGCNT; i++) {
+		struct page *p = spt_find_page (&t->spt, base + i * PGSIZE);
+		struct frame *frame = vm_frame_of (kva + i * PGSIZE);
+
+		frame->flags |= FRAME_HUGE;
+		frame_link (frame, p);
+		text_cache_insert (frame, p, gen);
+	}
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Maps PAGE, a file page, to the frame that already holds its
+ * contents for another process, if there is one.  The page starts
+ * out read-only; a write makes it writable in place (see
+ * vm_handle_wp).  Returns true if PAGE was mapped this way. */
+static bool
+vm_claim_text_page (struct page *page) {
+	struct text_entry key;
+	struct frame *frame;
+	bool success = false;
+
+	if (!text_key (page, &key))
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame = text_cache_find (&key);
+	if (frame != NULL) {
+		if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+			void *aux = page->uninit.aux;
+			page->uninit.page_initializer (page, page->uninit.type, frame->kva);
+			free (aux);
+		}
+		frame_link (frame, page);
+		success = pml4_set_page (page->owner->pml4, page->va, frame->kva, false);
+		if (!success)
+			frame_unlink (frame, page);
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Maps PAGE, a page of a shared memory segment, writable to the
+ * frame holding its contents.  If no process has the page in
+ * memory, a frame is allocated and filled from swap or with zeros
+ * first; the segment's lock keeps two processes faulting on the
+ * page at once from both doing so. */
+static bool
+vm_claim_shm_page (struct page *page) {
+	struct shm *shm;
+	struct shm_entry *e;
+	struct frame *frame;
+	bool success;
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		page->uninit.page_initializer (page, page->uninit.type, NULL);
+	shm = page->shm.shm;
+	e = &shm->pages[page->shm.idx];
+
+	lock_acquire (&shm->lock);
+	lock_acquire (&frame_lock);
+	while (e->frame != NULL && (e->frame->flags & FRAME_EVICT))
+		cond_wait (&evict_done, &frame_lock);
+	frame = e->frame;
+	if (frame == NULL) {
+		frame = vm_get_frame ();
+		if (frame == NULL) {
+			lock_release (&frame_lock);
+			lock_release (&shm->lock);
+			return false;
+		}
+		lock_release (&frame_lock);
+		swap_in (page, frame->kva);
+		lock_acquire (&frame_lock);
+		frame->pin_cnt--;
+		e->frame = frame;
+	}
+	frame_link (frame, page);
+	success = pml4_set_page (page->owner->pml4, page->va, frame->kva,
+			page->writable);
+	lock_release (&frame_lock);
+	lock_release (&shm->lock);
+	if (!success)
+		vm_free_frame (page);
+	return success;
+}
+
+/* Returns true if Q, a page at DELTA bytes from PAGE, is a not yet
+ * loaded page of the same segment as PAGE, i.e. it would be read
+ * from the same file DELTA bytes further on. */
+static bool
+is_same_segment (struct page *q, struct page *page, ptrdiff_t delta) {
+	struct segment *seg = page->uninit.aux, *qseg;
+	struct text_entry key;
+	bool cached;
+
+	if (q == NULL || VM_TYPE (q->operations->type) != VM_UNINIT
+			|| q->uninit.init != page->uninit.init
+			|| q->uninit.type != page->uninit.type
+			|| q->writable != page->writable || q->uninit.aux == NULL)
+		return false;
+	qseg = q->uninit.aux;
+	if (qseg->file != seg->file || qseg->offset != seg->offset + delta)
+		return false;
+
+	/* Leave pages that are already cached to vm_claim_text_page. */
+	lock_acquire (&frame_lock);
+	cached = text_key (q, &key) && text_cache_find (&key) != NULL;
+	lock_release (&frame_lock);
+	return !cached;
+}
+
+/* Loads PAGE, a not yet loaded page of an executable segment,
+ * together with the pages of the same segment next to it inside
+ * the vm_fault_around window.  The run of pages is read from the
+ * file with a single read.  ADVICE is the madvise() hint for PAGE.
+ * Returns true if PAGE was mapped; on false the caller loads PAGE
+ * on its own. */
+static bool
+vm_fault_around_segment (struct page *page, int advice) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	size_t pages = vm_fault_around;
+	size_t window;
+	uint8_t *base, *lo, *hi, *buf;
+	struct segment *first;
+	size_t cnt, bytes = 0;
+	unsigned gen;
+	bool mapped = false;
+
+	if (advice == MADV_SEQUENTIAL)
+		pages *= SEQ_READAHEAD;
+	if (pages < 2 || advice == MADV_RANDOM)
+		return false;
+	window = pages * PGSIZE;
+
+	/* Grow the run [LO, HI) around PAGE.  Only the last page may
+	 * end short of a full page of file data. */
+	if (advice == MADV_SEQUENTIAL)
+		base = page->va;
+	else
+		base = (uint8_t *) ((uint64_t) page->va / window * window);
+	lo = hi = page->va;
+	while (lo > base && is_same_segment (spt_get_page (spt, lo - PGSIZE),
+				page, lo - PGSIZE - (uint8_t *) page->va)) {
+		struct segment *seg = spt_find_page (spt, lo - PGSIZE)->uninit.aux;
+		if (seg->page_read_bytes != PGSIZE)
+			break;
+		lo -= PGSIZE;
+	}
+	for (;;) {
+		struct segment *seg = spt_find_page (spt, hi)->uninit.aux;
+		hi += PGSIZE;
+		bytes = hi - lo - PGSIZE + seg->page_read_bytes;
+		if (seg->page_read_bytes != PGSIZE || hi >= base + window
+				|| !is_same_segment (spt_get_page (spt, hi), page,
+					hi - (uint8_t *) page->va))
+			break;
+	}
+	cnt = (hi - lo) / PGSIZE;
+	if (cnt < 2)
+		return false;
+
+	buf = palloc_get_multiple (0, cnt);
+	if (buf == NULL)
+		return false;
+	first = spt_find_page (spt, lo)->uninit.aux;
+	gen = inode_write_gen (file_get_inode (first->file));
+	if (file_read_at (first->file, buf, bytes, first->offset) != (off_t) bytes) {
+		palloc_free_multiple (buf, cnt);
+		return false;
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *q = spt_find_page (spt, lo + i * PGSIZE);
+		struct segment *seg = q->uninit.aux;
+		struct frame *frame;
+
+		lock_acquire (&frame_lock);
+		frame = vm_get_frame ();
+		if (frame == NULL) {
+			lock_release (&frame_lock);
+			break;
+		}
+		frame_link (frame, q);
+		lock_release (&frame_lock);
+
+		memcpy (frame->kva, buf + i * PGSIZE, seg->page_read_bytes);
+		memset ((uint8_t *) frame->kva + seg->page_read_bytes, 0,
+				seg->page_zero_bytes);
+		if (!pml4_set_page (q->owner->pml4, q->va, frame->kva, q->writable)) {
+			frame->pin_cnt--;
+			vm_free_frame (q);
+			break;
+		}
+		q->uninit.page_initializer (q, q->uninit.type, frame->kva);
+		free (seg);
+		lock_acquire (&frame_lock);
+		text_cache_insert (frame, q, gen);
+		lock_release (&frame_lock);
+		frame->pin_cnt--;
+		if (q == page)
+			mapped = true;
+	}
+	palloc_free_multiple (buf, cnt);
+	return mapped;
 }
 
 /* Return true on success */
@@ -185,15 +1489,206 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
 	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
 	struct page *page = NULL;
+	bool success;
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
-	page = spt_find_page(spt, addr);
-	if (page == NULL){
+	if (spt->pages == NULL)
 		return false;
+	/* Killed by oom_kill(): let the process exit. */
+	if (user && thread_current ()->oom_killed)
+		return false;
+	lock_acquire (&spt->lock);
+	page = spt_get_page(spt, addr);
+	if (page == NULL)
+		success = false;
+	else if (!not_present)
+		success = write && page->writable && vm_handle_wp (page);
+	else if (!write && vm_claim_zero_page (page))
+		success = true;
+	else {
+		int advice = madvise_get (spt, page->va);
+		success = vm_load_page (page, advice);
+		if (success && advice == MADV_SEQUENTIAL)
+			vm_reclaim_behind (page);
+	}
+	lock_release (&spt->lock);
+	return success;
+}
+
+/* Loads PAGE into a frame: as part of a huge page, from the text
+ * cache, together with its neighbours or on its own, whichever
+ * works first.  ADVICE is the madvise() hint for PAGE.  The spt
+ * lock of PAGE's owner must be held. */
+static bool
+vm_load_page (struct page *page, int advice) {
+	if (page->frame != NULL) {
+		/* Loaded by prefaultd, or being evicted.  Let any eviction
+		 * finish; the access is retried and faults again if the
+		 * page went out. */
+		lock_acquire (&frame_lock);
+		page_wait_evict (page);
+		lock_release (&frame_lock);
+		return true;
+	}
+	vm_trim_resident (page->owner);
+	if (page_get_type (page) == VM_SHM)
+		return vm_claim_shm_page (page);
+	if (is_huge_candidate (page, page->writable) && vm_claim_huge_page (page))
+		return true;
+	if (vm_claim_text_page (page))
+		return true;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT
+			&& page->uninit.init != NULL && page->uninit.aux != NULL
+			&& vm_fault_around_segment (page, advice))
+		return true;
+	if (VM_TYPE (page->operations->type) == VM_ANON
+			&& page->anon.slot_number >= 0 && advice != MADV_RANDOM) {
+		int slot = page->anon.slot_number;
+		if (!vm_do_claim_page (page))
+			return false;
+		vm_swap_readahead (page, slot);
+		return true;
 	}
 	return vm_do_claim_page (page);
 }
 
+/* Returns the page of SPT that sits at the address SLOT - SLOT0
+ * pages from PAGE, the page read from SLOT0, if it is an anonymous
+ * page swapped out to SLOT, or NULL. */
+static struct page *
+swap_neighbour (struct supplemental_page_table *spt, struct page *page,
+		int slot0, int slot) {
+	struct page *q = spt_find_page (spt,
+			(uint8_t *) page->va + (ptrdiff_t) (slot - slot0) * PGSIZE);
+
+	if (q == NULL || VM_TYPE (q->operations->type) != VM_ANON
+			|| q->frame != NULL || q->anon.slot_number != slot)
+		return NULL;
+	return q;
+}
+
+/* Brings back from swap the neighbours of PAGE, which has just been
+ * read from SLOT: the pages before and after it that were swapped
+ * out next to it, as far as they go within the aligned cluster of
+ * SWAP_READAHEAD slots around SLOT.  They are read in slot order.
+ * Stops early rather than evict frames for pages that may never be
+ * touched.  The spt lock of PAGE's owner must be held. */
+static void
+vm_swap_readahead (struct page *page, int slot) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	int first = slot - slot % SWAP_READAHEAD;
+	int lo, hi;
+
+	for (lo = slot; lo > first && swap_neighbour (spt, page, slot, lo - 1); )
+		lo--;
+	for (hi = slot + 1; hi < first + SWAP_READAHEAD
+			&& swap_neighbour (spt, page, slot, hi); )
+		hi++;
+	for (int s = lo; s < hi; s++) {
+		struct page *q;
+
+		if (s == slot)
+			continue;
+		q = swap_neighbour (spt, page, slot, s);
+		if (q == NULL || palloc_user_free_cnt () <= wmark_high
+				|| over_rss_limit (q->owner)
+				|| !vm_do_claim_page (q))
+			break;
+		swap_readaheads++;
+	}
+}
+
+/* Returns true if T has as many resident pages as its limit
+ * allows, or more. */
+static bool
+over_rss_limit (struct thread *t) {
+	return t->rss_limit > 0 && t->rss_pages >= t->rss_limit;
+}
+
+/* Evicts pages of T, and only of T, until it has room below its
+ * resident limit for one more page, so a process over its limit
+ * pays for its own faults instead of taking frames from others.
+ * Frames shared with other processes are left alone; if nothing
+ * else is left, T is let over its limit. */
+static void
+vm_trim_resident (struct thread *t) {
+	lock_acquire (&frame_lock);
+	while (over_rss_limit (t)) {
+		struct frame *frame;
+		if (vm_evict_frames (t, &frame, 1) == 0)
+			break;
+		palloc_free_page (frame->kva);
+		limit_reclaimed++;
+	}
+	lock_release (&frame_lock);
+}
+
+/* Marks the frames of the pages a sequential reader of PAGE has
+ * left behind, SEQ_READAHEAD fault-around windows back, so that
+ * eviction takes them first. */
+static void
+vm_reclaim_behind (struct page *page) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	size_t dist = (size_t) SEQ_READAHEAD * (vm_fault_around > 0 ? vm_fault_around : 1)
+		* PGSIZE;
+	uint8_t *va = page->va;
+
+	if ((uint64_t) va < 2 * dist)
+		return;
+	lock_acquire (&frame_lock);
+	for (uint8_t *p = va - 2 * dist; p < va - dist; p += PGSIZE) {
+		struct page *q = spt_find_page (spt, p);
+		if (q != NULL && q->frame != NULL && q->frame->map_cnt == 1)
+			q->frame->flags |= FRAME_RECLAIM;
+	}
+	lock_release (&frame_lock);
+}
+
+/* Loads PAGE ahead of any access, for madvise(MADV_WILLNEED).
+ * The spt lock of PAGE's owner must be held. */
+bool
+vm_prefault_page (struct page *page) {
+	/* Zero-filled pages cost no I/O to fault in, and loading them one
+	 * by one would keep them out of huge pages. */
+	if (page->frame != NULL || is_zero_page (page))
+		return true;
+	return vm_load_page (page, madvise_get (&page->owner->spt, page->va));
+}
+
+/* Throws away the contents of PAGE, for madvise(MADV_DONTNEED).
+ * The page is removed, after write-back if it is a dirty file page,
+ * and is created afresh from its area when next touched: file data
+ * is read again and anonymous memory comes back zero-filled.  The
+ * spt lock of PAGE's owner must be held. */
+void
+vm_discard_page (struct page *page) {
+	spt_remove_page (&page->owner->spt, page);
+}
+
+/* Pins the frame of PAGE, so that it is not evicted.  Returns
+ * false, pinning nothing, if PAGE is not resident. */
+bool
+vm_pin_page (struct page *page) {
+	bool resident;
+
+	lock_acquire (&frame_lock);
+	page_wait_evict (page);
+	resident = page->frame != NULL;
+	if (resident)
+		page->frame->pin_cnt++;
+	lock_release (&frame_lock);
+	return resident;
+}
+
+/* Undoes vm_pin_page(). */
+void
+vm_unpin_page (struct page *page) {
+	lock_acquire (&frame_lock);
+	ASSERT (page->frame != NULL && page->frame->pin_cnt > 0);
+	page->frame->pin_cnt--;
+	lock_release (&frame_lock);
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void
@@ -208,7 +1703,7 @@ vm_claim_page (void *va UNUSED) {
 	struct page *page = NULL;
 	// struct thread *t = thread_current();
 	/* TODO: Fill this function */
-	page = spt_find_page(&thread_current()->spt, pg_round_down(va));
+	page = spt_get_page(&thread_current()->spt, pg_round_down(va));
 	if (page == NULL){
 		return false;
 	}
@@ -218,17 +1713,38 @@ vm_claim_page (void *va UNUSED) {
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
-	struct thread *t = thread_current();
+	struct frame *frame;
+	uint64_t *pml4 = page->owner->pml4;
+	unsigned gen = text_gen (page);
+	bool success = false;
+
+	if (page->frame != NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame = vm_get_frame ();
+	if (frame == NULL) {
+		lock_release (&frame_lock);
+		return false;
+	}
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	frame_link (frame, page);
+	lock_release (&frame_lock);
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 
-	if (pml4_get_page(t->pml4, page->va) == NULL &&  pml4_set_page (t->pml4, page->va, frame->kva, 1)){
-		return swap_in(page, frame->kva);
+	/* Fill the frame before mapping it: when prefaultd loads the
+	 * page, its owner may be running and touch it at any time. */
+	if (pml4_get_page(pml4, page->va) == NULL && swap_in(page, frame->kva))
+		success = pml4_set_page (pml4, page->va, frame->kva, page->writable);
+	if (success) {
+		lock_acquire (&frame_lock);
+		text_cache_insert (frame, page, gen);
+		lock_release (&frame_lock);
 	}
-	return false;
+	frame->pin_cnt--;
+	if (!success)
+		vm_free_frame (page);
+	return success;
 }
 
 /* Initialize new supplemental page table */
@@ -238,51 +1754,117 @@ supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	// 보충 페이지 테이블 초기화
 	spt->pages = calloc(sizeof(struct hash), 1); // 해시 테이블 사용을 위한 동적 할당
 	hash_init(spt->pages, page_hash, page_less, NULL);
+	spt->vmas = NULL;
+	spt->owner = thread_current ();
+	list_init (&spt->hints);
+	lock_init (&spt->lock);
+	spt->swap_va = NULL;
+	spt->swap_slot = -1;
+}
+
+/* Adds to DST a copy of SRC, a page that has been initialized.
+ * A resident page shares its frame with the copy, both read-only,
+ * until one of them writes to it; a swapped-out anonymous page
+ * shares its swap slot. */
+static bool
+vm_share_page (struct supplemental_page_table *dst, struct page *src) {
+	struct page *page = malloc (sizeof *page);
+	struct frame *frame;
+	bool success = true;
+
+	if (page == NULL)
+		return false;
+	memcpy (page, src, sizeof *page);
+	page->owner = thread_current ();
+	page->frame = NULL;
+	page->frame_next = NULL;
+	if (!spt_insert_page (dst, page)) {
+		free (page);
+		return false;
+	}
+	if (VM_TYPE (page->operations->type) == VM_FILE)
+		inode_reopen (page->file.inode);
+
+	lock_acquire (&frame_lock);
+	page_wait_evict (src);
+	frame = src->frame;
+	if (frame != NULL) {
+		frame_link (frame, page);
+		success = pml4_set_writable (src->owner->pml4, src->va, false)
+			&& pml4_set_page (page->owner->pml4, page->va, frame->kva, false);
+	} else if (VM_TYPE (src->operations->type) == VM_ANON
+			&& src->anon.slot_number >= 0)
+		swap_slot_dup (page);
+	lock_release (&frame_lock);
+	return success;
 }
 
 /* Copy supplemental page table from src to dst */
 /* 보충 페이지 테이블을 src에서 dst로 복사하는 함수 */
+/* Initialized pages are shared copy-on-write (see vm_share_page),
+ * so fork costs no page copies up front.  Areas are copied whole;
+ * their untouched pages are created in the child when it touches
+ * them, like in the parent. */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 		struct supplemental_page_table *src UNUSED) {
 	// TODO : src(부모) spt를 iterator를 이용하여 dst(자식) spt에 복사해주기
 	// TODO : page마다 type이 다르므로, copy 방식이 달라야함
 	/*	- UNINIT일때는, 그대로 복사하고 claim은 해줄 필요 없음 
-		- 외에는 부모 기반으로 똑같이 만들어준 뒤, 바로 claim 해주기 ㄱㄱ*/
+		- 외에는 부모와 frame을 공유하고, 쓰기가 일어날 때 복사 (copy-on-write) */
 	struct hash_iterator i;
+	bool success = false;
+
+	/* prefaultd may be loading pages of SRC. */
+	lock_acquire (&src->lock);
+	if (!vma_copy (dst, src) || !madvise_copy (dst, src))
+		goto done;
 	hash_first(&i, src->pages);
 	while (hash_next(&i)) {
 		struct page *src_cur = hash_entry(hash_cur(&i), struct page, hash_elem);
-		// printf("spt copy vmtype : %d\n", src_cur->operations->type);
 		// 0 : VM_UNINIT, 1 : VM_ANON, 2 : VM_FILE
 		void *va = src_cur->va;
 		bool writable = src_cur->writable;
 		enum vm_type type = src_cur->operations->type;
-		struct segment *aux = calloc(1, sizeof(struct segment));
+		struct segment *aux;
 
 		switch (VM_TYPE(type)){
 			case VM_UNINIT:
-				memcpy(aux, src_cur->uninit.aux, sizeof(struct segment));
+				if (src_cur->vma != NULL)
+					break;
+				aux = NULL;
+				if (src_cur->uninit.aux != NULL) {
+					aux = malloc(sizeof(struct segment));
+					if (aux == NULL)
+						goto done;
+					memcpy(aux, src_cur->uninit.aux, sizeof(struct segment));
+					/* The parent may close its executable before we
+					 * load from it. */
+					if (aux->file == src_cur->owner->running)
+						aux->file = thread_current ()->running;
+				}
 				if (!vm_alloc_page_with_initializer(src_cur->uninit.type,va,writable,src_cur->uninit.init, aux)){
 					free(aux);
-					return false;
+					goto done;
 				}
 				break;
 			case VM_ANON :
-				free(aux);
-				if (!(vm_alloc_page(type | VM_MARKER_0,va,writable) && vm_claim_page(va))){
-					return false;
-				}
-				struct page* child_p = spt_find_page(dst, va);
-				memcpy(child_p->frame->kva, src_cur->frame->kva, PGSIZE);	
-				break;
 			case VM_FILE :
+				if (!vm_share_page (dst, src_cur))
+					goto done;
+				break;
+			case VM_SHM :
+				/* The child maps the segment through its copy of the
+				 * area when it touches the page. */
 				break;
 			default :
 				PANIC("SPT COPY PANIC!\n");
 		}
 	}
-	return true;
+	success = true;
+done:
+	lock_release (&src->lock);
+	return success;
 }
 
 void page_destructor(struct hash_elem* hash_elem, void* aux){
@@ -296,7 +1878,16 @@ void
 supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
-   	hash_destroy(&spt->pages, page_destructor);
+	if (spt->pages == NULL)
+		return;
+	madvise_cancel (spt);
+	lock_acquire (&spt->lock);
+	hash_destroy(spt->pages, page_destructor);
+	free(spt->pages);
+	spt->pages = NULL;
+	vma_destroy (spt);
+	madvise_destroy (spt);
+	lock_release (&spt->lock);
 }
 
 /* Returns a hash value for page p. */
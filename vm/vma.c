@@ -0,0 +1,281 @@
+/* vma.c: Virtual memory areas.
+ *
+ * The areas of a process are disjoint and kept in an AVL tree
+ * ordered by start address, rooted at spt->vmas.  Mapping,
+ * unmapping and forking work on whole areas; struct page exists
+ * only for pages that have been touched. */
+
+#include "vm/vma.h"
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+
+static int
+height (struct vma *v) {
+	return v != NULL ? v->height : 0;
+}
+
+static void
+update_height (struct vma *v) {
+	int l = height (v->left), r = height (v->right);
+	v->height = (l > r ? l : r) + 1;
+}
+
+static struct vma *
+rotate_right (struct vma *y) {
+	struct vma *x = y->left;
+	y->left = x->right;
+	x->right = y;
+	update_height (y);
+	update_height (x);
+	return x;
+}
+
+static struct vma *
+rotate_left (struct vma *x) {
+	struct vma *y = x->right;
+	x->right = y->left;
+	y->left = x;
+	update_height (x);
+	update_height (y);
+	return y;
+}
+
+/* Restores the AVL balance of the subtree rooted at V after one of
+ * its children changed height by one.  Returns the new root. */
+static struct vma *
+rebalance (struct vma *v) {
+	int balance;
+
+	update_height (v);
+	balance = height (v->left) - height (v->right);
+	if (balance > 1) {
+		if (height (v->left->left) < height (v->left->right))
+			v->left = rotate_left (v->left);
+		return rotate_right (v);
+	}
+	if (balance < -1) {
+		if (height (v->right->right) < height (v->right->left))
+			v->right = rotate_right (v->right);
+		return rotate_left (v);
+	}
+	return v;
+}
+
+static struct vma *
+tree_insert (struct vma *root, struct vma *v) {
+	if (root == NULL)
+		return v;
+	if (v->start < root->start)
+		root->left = tree_insert (root->left, v);
+	else
+		root->right = tree_insert (root->right, v);
+	return rebalance (root);
+}
+
+/* Detaches the leftmost node of ROOT into *MIN. */
+static struct vma *
+tree_remove_min (struct vma *root, struct vma **min) {
+	if (root->left == NULL) {
+		*min = root;
+		return root->right;
+	}
+	root->left = tree_remove_min (root->left, min);
+	return rebalance (root);
+}
+
+static struct vma *
+tree_remove (struct vma *root, struct vma *v) {
+	struct vma *min;
+
+	ASSERT (root != NULL);
+	if (root == v) {
+		if (v->right == NULL)
+			return v->left;
+		v->right = tree_remove_min (v->right, &min);
+		min->left = v->left;
+		min->right = v->right;
+		return rebalance (min);
+	}
+	if (v->start < root->start)
+		root->left = tree_remove (root->left, v);
+	else
+		root->right = tree_remove (root->right, v);
+	return rebalance (root);
+}
+
+/* Returns the area of SPT that contains VA, or NULL. */
+struct vma *
+vma_find (struct supplemental_page_table *spt, const void *va) {
+	struct vma *v = spt->vmas;
+
+	while (v != NULL) {
+		if ((const uint8_t *) va < v->start)
+			v = v->left;
+		else if ((const uint8_t *) va >= v->end)
+			v = v->right;
+		else
+			return v;
+	}
+	return NULL;
+}
+
+/* Returns true if any area of SPT intersects [START, END). */
+bool
+vma_overlaps (struct supplemental_page_table *spt,
+		const void *start, const void *end) {
+	struct vma *v = spt->vmas;
+
+	while (v != NULL) {
+		if ((const uint8_t *) end <= v->start)
+			v = v->left;
+		else if ((const uint8_t *) start >= v->end)
+			v = v->right;
+		else
+			return true;
+	}
+	return false;
+}
+
+/* Adds to SPT an area of LENGTH bytes at START, rounded up to whole
+ * pages, whose pages are of TYPE and zero-filled.  The caller fills
+ * in the file fields before the area is used.  Returns NULL if the
+ * range overlaps another area or out of memory. */
+struct vma *
+vma_map (struct supplemental_page_table *spt, void *start, size_t length,
+		bool writable, enum vm_type type) {
+	struct vma *v;
+
+	ASSERT (pg_ofs (start) == 0);
+	ASSERT (length > 0);
+
+	if (vma_overlaps (spt, start, (uint8_t *) start + length))
+		return NULL;
+	v = calloc (1, sizeof *v);
+	if (v == NULL)
+		return NULL;
+	v->start = start;
+	v->end = pg_round_up ((uint8_t *) start + length);
+	v->type = type;
+	v->writable = writable;
+	v->height = 1;
+	list_init (&v->pages);
+	spt->vmas = tree_insert (spt->vmas, v);
+	return v;
+}
+
+/* Removes VMA and its pages from SPT.  Dirty file pages are written
+ * back on the way, and a shared memory segment loses the area. */
+void
+vma_unmap (struct supplemental_page_table *spt, struct vma *vma) {
+	while (!list_empty (&vma->pages))
+		spt_remove_page (spt,
+				list_entry (list_front (&vma->pages), struct page, vma_elem));
+	spt->vmas = tree_remove (spt->vmas, vma);
+	if (vma->flags & VMA_MMAP)
+		file_close (vma->file);
+	if (vma->shm != NULL)
+		shm_put (vma->shm);
+	free (vma);
+}
+
+/* Creates the page at VA, inside VMA, in SPT. */
+bool
+vma_alloc_page (struct supplemental_page_table *spt, struct vma *vma,
+		void *va) {
+	size_t ofs = (uint8_t *) va - vma->start;
+	struct segment *seg;
+	enum vm_type type;
+
+	ASSERT (pg_ofs (va) == 0);
+	ASSERT ((uint8_t *) va >= vma->start && (uint8_t *) va < vma->end);
+
+	if (vma->shm != NULL)
+		return spt_alloc_page (spt, VM_SHM, va, vma->writable, NULL, NULL);
+
+	/* Pages with no file data need no loader and may become part of
+	 * a huge page. */
+	if (ofs >= vma->read_bytes) {
+		type = vma->file != NULL ? VM_ANON | VM_ZERO : vma->type | VM_ZERO;
+		return spt_alloc_page (spt, type, va, vma->writable, NULL, NULL);
+	}
+
+	seg = malloc (sizeof *seg);
+	if (seg == NULL)
+		return false;
+	seg->file = vma->file;
+	seg->offset = vma->offset + ofs;
+	seg->page_read_bytes = vma->read_bytes - ofs < PGSIZE
+		? vma->read_bytes - ofs : PGSIZE;
+	seg->page_zero_bytes = PGSIZE - seg->page_read_bytes;
+	if (!spt_alloc_page (spt, vma->type, va, vma->writable, vma->init, seg)) {
+		free (seg);
+		return false;
+	}
+	return true;
+}
+
+/* Copies the subtree ROOT of the parent SRC into *COPY for the
+ * child DST.  Program areas are backed by the child's own copy of
+ * its executable, mmap() areas by a duplicate of their file.
+ * Shared memory areas map the same segment in both.  On failure *COPY holds whatever was copied, for vma_destroy. */
+static bool
+tree_copy (struct vma *root, struct vma **copy,
+		struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct vma *v;
+
+	*copy = NULL;
+	if (root == NULL)
+		return true;
+	v = malloc (sizeof *v);
+	if (v == NULL)
+		return false;
+	memcpy (v, root, sizeof *v);
+	list_init (&v->pages);
+	v->left = v->right = NULL;
+	*copy = v;
+	if (v->shm != NULL)
+		shm_get (v->shm);
+	if (v->flags & VMA_MMAP)
+		v->file = file_duplicate (root->file);
+	else if (root->file != NULL && root->file == src->owner->running)
+		v->file = dst->owner->running;
+	if (root->file != NULL && v->file == NULL) {
+		v->flags &= ~VMA_MMAP;
+		return false;
+	}
+	return tree_copy (root->left, &v->left, dst, src)
+		&& tree_copy (root->right, &v->right, dst, src);
+}
+
+/* Gives DST, the table of a process being forked from SRC, a copy
+ * of each of SRC's areas.  Their pages are copied separately. */
+bool
+vma_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	return tree_copy (src->vmas, &dst->vmas, dst, src);
+}
+
+static void
+tree_destroy (struct vma *v) {
+	if (v == NULL)
+		return;
+	tree_destroy (v->left);
+	tree_destroy (v->right);
+	if (v->flags & VMA_MMAP)
+		file_close (v->file);
+	if (v->shm != NULL)
+		shm_put (v->shm);
+	free (v);
+}
+
+/* Frees the areas of SPT, whose pages are already gone. */
+void
+vma_destroy (struct supplemental_page_table *spt) {
+	tree_destroy (spt->vmas);
+	spt->vmas = NULL;
+}
@@ -0,0 +1,314 @@
+/* zswap.c: Compressed RAM cache in front of the swap disk.
+ *
+ * An anonymous page being swapped out is compressed and kept in
+ * kernel memory under the swap slot it was given, so swapping it
+ * back in is a decompression instead of eight sector reads.  The
+ * pool is bounded; when it is full the oldest entries are
+ * decompressed and written to their slots on the swap disk.  Pages
+ * that do not compress well go straight to disk. */
+
+#include "vm/zswap.h"
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A compressed page. */
+struct zswap_entry {
+	struct hash_elem elem;      /* Element in zswap_table. */
+	struct list_elem lru;       /* Element in zswap_lru. */
+	int slot;                   /* Swap slot that owns the data. */
+	size_t len;                 /* Bytes of DATA. */
+	uint8_t data[];             /* Compressed page. */
+};
+
+/* Pages that compress to more than this are not worth caching. */
+#define ZSWAP_MAX_LEN (PGSIZE / 4 * 3)
+
+/* Percentage of user memory the pool may use; 0 turns zswap off.
+ * Set with -zswap=PCT. */
+unsigned zswap_percent;
+
+static struct hash zswap_table;     /* Entries keyed by slot. */
+static struct list zswap_lru;       /* Entries, oldest first. */
+static struct lock zswap_lock;      /* Protects everything below. */
+static size_t pool_bytes;           /* Memory held by entries. */
+static size_t pool_limit;           /* Upper bound on pool_bytes. */
+static uint8_t *zswap_buf;          /* Scratch page for the codec. */
+static zswap_writeback_func *zswap_writeback;  /* NULL if off. */
+
+/* Statistics. */
+static size_t zswap_stored;         /* Pages compressed. */
+static size_t zswap_loaded;         /* Swap-ins served from RAM. */
+static size_t zswap_written;        /* Entries written back to disk. */
+static size_t zswap_rejected;       /* Pages that did not compress. */
+
+static size_t lz_compress (const uint8_t *src, size_t n,
+		uint8_t *dst, size_t cap);
+static size_t lz_decompress (const uint8_t *src, size_t n,
+		uint8_t *dst, size_t cap);
+
+static uint64_t
+zswap_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct zswap_entry, elem)->slot);
+}
+
+static bool
+zswap_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct zswap_entry, elem)->slot
+		< hash_entry (b, struct zswap_entry, elem)->slot;
+}
+
+/* Sets up a pool of at most MAX_BYTES.  Entries pushed out of the
+ * pool are handed to WRITEBACK. */
+void
+zswap_init (size_t max_bytes, zswap_writeback_func *writeback) {
+	ASSERT (writeback != NULL);
+
+	zswap_buf = palloc_get_page (0);
+	if (zswap_buf == NULL)
+		PANIC ("zswap_init: cannot allocate buffer");
+	hash_init (&zswap_table, zswap_hash, zswap_less, NULL);
+	list_init (&zswap_lru);
+	lock_init (&zswap_lock);
+	pool_limit = max_bytes;
+	zswap_writeback = writeback;
+}
+
+/* Returns the entry for SLOT, or NULL.  zswap_lock must be held. */
+static struct zswap_entry *
+zswap_find (int slot) {
+	struct zswap_entry key;
+	struct hash_elem *e;
+
+	key.slot = slot;
+	e = hash_find (&zswap_table, &key.elem);
+	return e != NULL ? hash_entry (e, struct zswap_entry, elem) : NULL;
+}
+
+/* Takes E out of the pool and frees it.  zswap_lock must be held. */
+static void
+zswap_remove (struct zswap_entry *e) {
+	hash_delete (&zswap_table, &e->elem);
+	list_remove (&e->lru);
+	pool_bytes -= sizeof *e + e->len;
+	free (e);
+}
+
+/* Writes the oldest entry to the swap disk and drops it.
+ * zswap_buf is clobbered.  zswap_lock must be held. */
+static void
+zswap_evict_oldest (void) {
+	struct zswap_entry *e =
+		list_entry (list_front (&zswap_lru), struct zswap_entry, lru);
+
+	if (lz_decompress (e->data, e->len, zswap_buf, PGSIZE) != PGSIZE)
+		PANIC ("zswap: corrupted entry for slot %d", e->slot);
+	zswap_writeback (e->slot, zswap_buf);
+	zswap_remove (e);
+	zswap_written++;
+}
+
+/* Compresses PAGE into the pool under SLOT.  Returns false if zswap
+ * is off or the page is not worth keeping, in which case the caller
+ * must write it to disk itself. */
+bool
+zswap_store (int slot, const void *page) {
+	struct zswap_entry *e;
+	size_t len;
+
+	if (zswap_writeback == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	ASSERT (zswap_find (slot) == NULL);
+	len = lz_compress (page, PGSIZE, zswap_buf, ZSWAP_MAX_LEN);
+	e = len != 0 ? malloc (sizeof *e + len) : NULL;
+	if (e == NULL || sizeof *e + len > pool_limit) {
+		free (e);
+		zswap_rejected++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+	e->slot = slot;
+	e->len = len;
+	memcpy (e->data, zswap_buf, len);
+
+	/* Make room only after the copy: eviction reuses zswap_buf. */
+	while (pool_bytes + sizeof *e + len > pool_limit)
+		zswap_evict_oldest ();
+	hash_insert (&zswap_table, &e->elem);
+	list_push_back (&zswap_lru, &e->lru);
+	pool_bytes += sizeof *e + len;
+	zswap_stored++;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Decompresses the page held for SLOT into PAGE.  Returns false if
+ * SLOT is not in the pool and must be read from disk.  The entry
+ * stays until the slot is invalidated, since other pages forked
+ * from the same one may still refer to it. */
+bool
+zswap_load (int slot, void *page) {
+	struct zswap_entry *e;
+
+	if (zswap_writeback == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	e = zswap_find (slot);
+	if (e != NULL) {
+		if (lz_decompress (e->data, e->len, page, PGSIZE) != PGSIZE)
+			PANIC ("zswap: corrupted entry for slot %d", slot);
+		zswap_loaded++;
+	}
+	lock_release (&zswap_lock);
+	return e != NULL;
+}
+
+/* Forgets SLOT, which has just been freed. */
+void
+zswap_invalidate (int slot) {
+	struct zswap_entry *e;
+
+	if (zswap_writeback == NULL)
+		return;
+
+	lock_acquire (&zswap_lock);
+	e = zswap_find (slot);
+	if (e != NULL)
+		zswap_remove (e);
+	lock_release (&zswap_lock);
+}
+
+void
+zswap_print_stats (void) {
+	if (zswap_writeback != NULL)
+		printf ("zswap: %zu pages stored, %zu loaded from RAM, "
+				"%zu written back, %zu rejected\n",
+				zswap_stored, zswap_loaded, zswap_written, zswap_rejected);
+}
+
+/* A byte-oriented LZ77 codec.  The output is a sequence of
+ * commands, each starting with a control byte C:
+ *
+ *   C < 0x80:  C + 1 literal bytes follow.
+ *   C >= 0x80: copy (C & 0x7f) + LZ_MIN_MATCH bytes from OFFSET
+ *              bytes back in the output, where OFFSET is the
+ *              little-endian 16-bit value that follows.
+ *
+ * Matches are found through a hash of the next three bytes, which
+ * remembers only the latest position for each hash value. */
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 0x7f)
+#define LZ_MAX_LITERAL 0x80
+#define LZ_HASH_BITS 12
+
+/* Position + 1 of the last occurrence of each hash; 0 if none.
+ * Only used under zswap_lock. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static inline unsigned
+lz_hash (const uint8_t *p) {
+	uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Emits SRC[FROM, TO) as literals.  Returns the new output length,
+ * or 0 if it would exceed CAP. */
+static size_t
+lz_literals (const uint8_t *src, size_t from, size_t to,
+		uint8_t *dst, size_t op, size_t cap) {
+	while (from < to) {
+		size_t cnt = to - from < LZ_MAX_LITERAL ? to - from : LZ_MAX_LITERAL;
+		if (op + 1 + cnt > cap)
+			return 0;
+		dst[op++] = cnt - 1;
+		memcpy (dst + op, src + from, cnt);
+		op += cnt;
+		from += cnt;
+	}
+	return op;
+}
+
+/* Compresses N bytes of SRC into DST.  Returns the compressed
+ * length, or 0 if it would be more than CAP bytes. */
+static size_t
+lz_compress (const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+	size_t ip = 0, op = 0, lit = 0;
+
+	ASSERT (n <= UINT16_MAX);
+
+	memset (lz_table, 0, sizeof lz_table);
+	while (ip + LZ_MIN_MATCH <= n) {
+		unsigned h = lz_hash (src + ip);
+		size_t cand = lz_table[h];
+		size_t len;
+
+		lz_table[h] = ip + 1;
+		if (cand-- == 0 || memcmp (src + cand, src + ip, LZ_MIN_MATCH)) {
+			ip++;
+			continue;
+		}
+
+		len = LZ_MIN_MATCH;
+		while (ip + len < n && len < LZ_MAX_MATCH
+				&& src[cand + len] == src[ip + len])
+			len++;
+
+		if (lit < ip && (op = lz_literals (src, lit, ip, dst, op, cap)) == 0)
+			return 0;
+		if (op + 3 > cap)
+			return 0;
+		dst[op++] = 0x80 | (len - LZ_MIN_MATCH);
+		dst[op++] = (ip - cand) & 0xff;
+		dst[op++] = (ip - cand) >> 8;
+		ip += len;
+		lit = ip;
+	}
+	if (lit < n && (op = lz_literals (src, lit, n, dst, op, cap)) == 0)
+		return 0;
+	return op;
+}
+
+/* Decompresses N bytes of SRC into DST, which holds CAP bytes.
+ * Returns the decompressed length, or 0 if SRC is malformed. */
+static size_t
+lz_decompress (const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+	size_t ip = 0, op = 0;
+
+	while (ip < n) {
+		uint8_t c = src[ip++];
+
+		if (c & 0x80) {
+			size_t len = (c & 0x7f) + LZ_MIN_MATCH;
+			size_t off;
+
+			if (ip + 2 > n)
+				return 0;
+			off = src[ip] | src[ip + 1] << 8;
+			ip += 2;
+			if (off == 0 || off > op || op + len > cap)
+				return 0;
+			/* Byte by byte: the source may overlap the copy. */
+			for (; len > 0; len--, op++)
+				dst[op] = dst[op - off];
+		} else {
+			size_t len = c + 1;
+
+			if (ip + len > n || op + len > cap)
+				return 0;
+			memcpy (dst + op, src + ip, len);
+			ip += len;
+			op += len;
+		}
+	}
+	return op;
+}